@@ -0,0 +1,262 @@
+/*
+ * Audible Planets - an expressive, quasi-Ptolemaic semi-modular synthesizer
+ *
+ * Copyright 2024, Greg Recco
+ *
+ * Audible Planets is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * All source for Audible Planets is available at
+ * https://github.com/gregrecco67/AudiblePlanets
+ */
+
+
+// Timing harness for the DSP, built with -DAP_BUILD_BENCHMARKS=ON. Run it
+// with the name of a benchmark, or nothing for all of them:
+//
+//   voices        processBlock with 1-64 voices, default patch and filter
+//                 mode: the cost of each added voice
+//   voicebank     processBlock with 1-16 voices in svfBank filter mode, with
+//                 and without VoiceBank, to check VoiceBank::minVoices
+//   controlblock  8 voices through 1024- and 4096-sample host blocks at each
+//                 control block size: throughput against modulation steps
+//   decimators    the stereo decimators against two mono hiir::Downsampler2xSse
+//                 per stage, on 32-sample blocks (SSE builds only)
+//
+// Build it in Release, with the AP_SIMD_LEVEL the plugin ships with.
+
+#include "PluginProcessor.h"
+#include "StereoDownsampler.h"
+#include "hiir/Downsampler2xSse.h"
+#include "hiir/PolyphaseIir2Designer.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+
+namespace {
+
+constexpr double sampleRate = 44100.0;
+constexpr int blockSize = 256;
+constexpr int warmupSamples = 50 * blockSize;
+constexpr int timedSamples = 500 * blockSize;
+
+// a processor set up the way the benchmarks need it: enough polyphony for
+// any count they ask for, voices rendered on the calling thread only. It's
+// too big for the stack, so make one with std::make_unique
+struct Rig {
+	// controlBlock is the param's setting: 16 << controlBlock samples
+	explicit Rig(const float filterMode, const int hostBlock = blockSize, const int controlBlock = 1)
+		: buffer(2, hostBlock)
+	{
+		proc.globalParams.polyphony->setUserValue(static_cast<float>(APAudioProcessor::maxVoices));
+		proc.globalParams.renderThreads->setUserValue(1.0f);
+		proc.globalParams.controlBlock->setUserValue(static_cast<float>(controlBlock));
+		proc.filterParams.mode->setUserValue(filterMode);
+		proc.prepareToPlay(sampleRate, hostBlock);
+	}
+
+	// microseconds per host block with numNotes held
+	double timeNotes(const int numNotes)
+	{
+		proc.synth.turnOffAllVoices(false);
+		proc.reset();
+
+		juce::MidiBuffer midi;
+		for (int n = 0; n < numNotes; n++)
+			midi.addEvent(juce::MidiMessage::noteOn(1, 24 + n, 0.8f), 0);
+
+		const int numSamples = buffer.getNumSamples();
+		for (int b = 0; b < warmupSamples / numSamples; b++) {
+			proc.processBlock(buffer, midi);
+			midi.clear();
+		}
+
+		const auto start = std::chrono::steady_clock::now();
+		for (int b = 0; b < timedSamples / numSamples; b++)
+			proc.processBlock(buffer, midi);
+		const std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+		return elapsed.count() / (timedSamples / numSamples);
+	}
+
+	APAudioProcessor proc;
+	juce::AudioBuffer<float> buffer;
+};
+
+void benchVoices()
+{
+	std::printf("voices: us per %d-sample block at %.0f Hz, per-voice filter mode\n", blockSize, sampleRate);
+	std::printf("%6s %12s %12s %12s\n", "voices", "block", "per voice", "% realtime");
+
+	const auto rig = std::make_unique<Rig>(static_cast<float>(SynthVoice3::FilterMode::perVoice));
+	const double blockTime = blockSize / sampleRate * 1.0e6;
+	const double idle = rig->timeNotes(0);
+	std::printf("%6d %12.1f %12s %12.2f\n", 0, idle, "", 100.0 * idle / blockTime);
+	for (const int voices : {1, 2, 4, 8, 16, 32, 64}) {
+		const double t = rig->timeNotes(voices);
+		std::printf("%6d %12.1f %12.2f %12.2f\n", voices, t, (t - idle) / voices, 100.0 * t / blockTime);
+	}
+}
+
+void benchVoiceBank()
+{
+	std::printf("voicebank: us per %d-sample block at %.0f Hz, svfBank filter mode\n", blockSize, sampleRate);
+	std::printf("%6s %12s %12s\n", "voices", "per-voice", "banked");
+
+	const auto rig = std::make_unique<Rig>(static_cast<float>(SynthVoice3::FilterMode::svfBank));
+	for (int voices = 1; voices <= 16; voices++) {
+		rig->proc.synth.setVoiceBanksEnabled(false);
+		const double single = rig->timeNotes(voices);
+		rig->proc.synth.setVoiceBanksEnabled(true);
+		const double banked = rig->timeNotes(voices);
+		std::printf("%6d %12.1f %12.1f\n", voices, single, banked);
+	}
+}
+
+void benchControlBlock()
+{
+	std::printf("controlblock: 8 voices at %.0f Hz; us per 1000 samples, and ms between\n", sampleRate);
+	std::printf("global modulation updates\n");
+	std::printf("%10s %10s %12s %12s\n", "host block", "control", "us / 1000", "step (ms)");
+
+	for (const int hostBlock : {1024, 4096}) {
+		for (int setting = 0; setting <= 4; setting++) {
+			const auto rig = std::make_unique<Rig>(static_cast<float>(SynthVoice3::FilterMode::perVoice), hostBlock, setting);
+			const int control = rig->proc.getControlBlockSize();
+			const double t = rig->timeNotes(8);
+			std::printf("%10d %10d %12.1f %12.2f\n", hostBlock, control, t * 1000.0 / hostBlock,
+				control / sampleRate * 1000.0);
+		}
+	}
+}
+
+#if JUCE_USE_SSE_INTRINSICS
+// both ways of taking one stereo pair through 2x decimation, the way the
+// processor used to (one hiir instance per channel) and the way it does now
+template <int NC>
+struct MonoPair {
+	explicit MonoPair(const double coefs[])
+	{
+		left.set_coefs(coefs);
+		right.set_coefs(coefs);
+	}
+	void processBlock(float *outL, float *outR, const float *inL, const float *inR, const int numSamples)
+	{
+		left.process_block(outL, inL, numSamples);
+		right.process_block(outR, inR, numSamples);
+	}
+	hiir::Downsampler2xSse<NC> left, right;
+};
+
+template <int NC>
+struct StereoPair {
+	explicit StereoPair(const double coefs[]) { stereo.setCoefs(coefs); }
+	void processBlock(float *outL, float *outR, const float *inL, const float *inR, const int numSamples)
+	{
+		stereo.processBlock(outL, outR, inL, inR, numSamples);
+	}
+	StereoDownsampler2x<NC> stereo;
+};
+
+constexpr int decimatorBlock = 32;  // output samples, the old MINI_BLOCK_SIZE
+constexpr int decimatorBlocks = 200000;
+
+struct DecimatorInput {
+	DecimatorInput()
+	{
+		std::mt19937 gen{1};
+		std::uniform_real_distribution<float> dist{-1.f, 1.f};
+		for (auto *channel : {l, r})
+			for (int i = 0; i < decimatorBlock * 4; i++)
+				channel[i] = dist(gen);
+	}
+	alignas(16) float l[decimatorBlock * 4], r[decimatorBlock * 4];
+};
+
+// ns per block of one 2x stage; the output feeds nothing, so it's summed
+// into sink to keep the work
+template <typename Decimator>
+double timeStage(Decimator &d, const DecimatorInput &in, float &sink)
+{
+	alignas(16) float outL[decimatorBlock], outR[decimatorBlock];
+	const auto start = std::chrono::steady_clock::now();
+	for (int b = 0; b < decimatorBlocks; b++) {
+		d.processBlock(outL, outR, in.l, in.r, decimatorBlock);
+		sink += outL[0] + outR[decimatorBlock - 1];
+	}
+	const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count() / decimatorBlocks;
+}
+
+// 4x down to 1x: two stages through a 2x buffer, against the fused decimator
+template <typename First, typename Second>
+double timeTwoStages(First &first, Second &second, const DecimatorInput &in, float &sink)
+{
+	alignas(16) float midL[decimatorBlock * 2], midR[decimatorBlock * 2];
+	alignas(16) float outL[decimatorBlock], outR[decimatorBlock];
+	const auto start = std::chrono::steady_clock::now();
+	for (int b = 0; b < decimatorBlocks; b++) {
+		first.processBlock(midL, midR, in.l, in.r, decimatorBlock * 2);
+		second.processBlock(outL, outR, midL, midR, decimatorBlock);
+		sink += outL[0] + outR[decimatorBlock - 1];
+	}
+	const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count() / decimatorBlocks;
+}
+
+void benchDecimators()
+{
+	// the coefficients the processor uses for 4x to 2x and 2x to 1x
+	double coefs1[3], coefs2[8];
+	hiir::PolyphaseIir2Designer::compute_coefs_spec_order_tbw(coefs1, 3, .28);
+	hiir::PolyphaseIir2Designer::compute_coefs_spec_order_tbw(coefs2, 8, .03);
+
+	const DecimatorInput in;
+	float sink = 0.f;
+
+	std::printf("decimators: ns per %d-sample stereo output block\n", decimatorBlock);
+	std::printf("%-24s %12s %12s\n", "", "2x hiir", "stereo");
+	{
+		MonoPair<3> mono(coefs1);
+		StereoPair<3> stereo(coefs1);
+		std::printf("%-24s %12.1f %12.1f\n", "2x, 3 coefs", timeStage(mono, in, sink), timeStage(stereo, in, sink));
+	}
+	{
+		MonoPair<8> mono(coefs2);
+		StereoPair<8> stereo(coefs2);
+		std::printf("%-24s %12.1f %12.1f\n", "2x, 8 coefs", timeStage(mono, in, sink), timeStage(stereo, in, sink));
+	}
+	{
+		MonoPair<3> mono1(coefs1);
+		MonoPair<8> mono2(coefs2);
+		StereoDecimator4x<3, 8> fused;
+		fused.setCoefs(coefs1, coefs2);
+		std::printf("%-24s %12.1f %12.1f\n", "4x, 3 + 8 coefs (fused)",
+			timeTwoStages(mono1, mono2, in, sink), timeStage(fused, in, sink));
+	}
+	std::printf("(%g)\n", static_cast<double>(sink));
+}
+#endif
+
+}  // namespace
+
+int main(int argc, char *argv[])
+{
+	const juce::ScopedJuceInitialiser_GUI init;
+
+	const auto wants = [&](const char *name) { return argc < 2 || std::strcmp(argv[1], name) == 0; };
+	if (wants("voices"))
+		benchVoices();
+	if (wants("voicebank"))
+		benchVoiceBank();
+	if (wants("controlblock"))
+		benchControlBlock();
+#if JUCE_USE_SSE_INTRINSICS
+	if (wants("decimators"))
+		benchDecimators();
+#endif
+	return 0;
+}
@@ -0,0 +1,102 @@
+/*
+ * Audible Planets - an expressive, quasi-Ptolemaic semi-modular synthesizer
+ *
+ * Copyright 2024, Greg Recco
+ *
+ * Audible Planets is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * All source for Audible Planets is available at
+ * https://github.com/gregrecco67/AudiblePlanets
+ */
+
+#include "AllocationTrap.h"
+
+#if AP_TRAP_AUDIO_ALLOCATIONS
+
+#include <juce_core/juce_core.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <utility>
+
+namespace {
+thread_local int trapDepth = 0;
+
+void checkAllocation()
+{
+	if (trapDepth == 0)
+		return;
+
+	// report with the trap off, or the report's own allocations land here
+	const int depth = std::exchange(trapDepth, 0);
+	std::fputs("Audible Planets: heap allocation on the audio thread\n", stderr);
+	jassertfalse;
+#if !JUCE_DEBUG
+	std::abort();
+#endif
+	trapDepth = depth;
+}
+
+void *allocate(std::size_t size)
+{
+	checkAllocation();
+	if (void *p = std::malloc(size == 0 ? 1 : size))
+		return p;
+	throw std::bad_alloc();
+}
+
+void *allocateAligned(std::size_t size, std::align_val_t al)
+{
+	checkAllocation();
+	const auto alignment = std::max(static_cast<std::size_t>(al), sizeof(void *));
+	size = (std::max<std::size_t>(size, 1) + alignment - 1) / alignment * alignment;
+#if JUCE_WINDOWS
+	if (void *p = _aligned_malloc(size, alignment))
+		return p;
+#else
+	if (void *p = std::aligned_alloc(alignment, size))
+		return p;
+#endif
+	throw std::bad_alloc();
+}
+
+void freeAligned(void *p) noexcept
+{
+#if JUCE_WINDOWS
+	_aligned_free(p);
+#else
+	std::free(p);
+#endif
+}
+}  // namespace
+
+ScopedAllocationTrap::ScopedAllocationTrap() noexcept { ++trapDepth; }
+ScopedAllocationTrap::~ScopedAllocationTrap() noexcept { --trapDepth; }
+
+void *operator new(std::size_t size) { return allocate(size); }
+void *operator new[](std::size_t size) { return allocate(size); }
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+	try { return allocate(size); } catch (...) { return nullptr; }
+}
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+	try { return allocate(size); } catch (...) { return nullptr; }
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+
+void *operator new(std::size_t size, std::align_val_t al) { return allocateAligned(size, al); }
+void *operator new[](std::size_t size, std::align_val_t al) { return allocateAligned(size, al); }
+void operator delete(void *p, std::align_val_t) noexcept { freeAligned(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { freeAligned(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept { freeAligned(p); }
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept { freeAligned(p); }
+
+#endif
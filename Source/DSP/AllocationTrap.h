@@ -0,0 +1,33 @@
+/*
+ * Audible Planets - an expressive, quasi-Ptolemaic semi-modular synthesizer
+ *
+ * Copyright 2024, Greg Recco
+ *
+ * Audible Planets is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * All source for Audible Planets is available at
+ * https://github.com/gregrecco67/AudiblePlanets
+ */
+
+#pragma once
+
+//==============================================================================
+// Built with -DAP_TRAP_AUDIO_ALLOCATIONS=ON, the plugin replaces the global
+// operator new/delete, and any allocation made on a thread that is inside a
+// ScopedAllocationTrap breaks into the debugger (and aborts in a release
+// build). Otherwise the guard compiles to nothing.
+#if AP_TRAP_AUDIO_ALLOCATIONS
+struct ScopedAllocationTrap {
+	ScopedAllocationTrap() noexcept;
+	~ScopedAllocationTrap() noexcept;
+	ScopedAllocationTrap(const ScopedAllocationTrap &) = delete;
+	ScopedAllocationTrap &operator=(const ScopedAllocationTrap &) = delete;
+};
+#else
+struct ScopedAllocationTrap {
+	ScopedAllocationTrap() noexcept {}
+};
+#endif
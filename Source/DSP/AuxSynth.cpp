@@ -6,7 +6,7 @@ AuxSynth::AuxSynth(APAudioProcessor &proc_) : proc(proc_)
 	enableLegacyMode(12);
 	setVoiceStealingEnabled(true);
 
-	for (int i = 0; i < 16; i++) {
+	for (int i = 0; i < APAudioProcessor::maxVoices; i++) {
 		auto voice = new AuxSynthVoice(proc);
 		proc.modMatrix.addVoice(voice);
 		addVoice(voice);
@@ -13,13 +13,14 @@
  */
 
 #include "AuxSynthVoice.h"
+#include "FastMath.hpp"
 #include "PluginProcessor.h"
 
 //==============================================================================
 AuxSynthVoice::AuxSynthVoice(APAudioProcessor &p)
     : proc(p), osc(proc.analogTables, 8), mseg1(proc.mseg1Data),
       mseg2(proc.mseg2Data), mseg3(proc.mseg3Data), mseg4(proc.mseg4Data),
-	  env1(proc.convex), env2(proc.convex), env3(proc.convex), env4(proc.convex)
+	  env1(proc.envelopeShapes), env2(proc.envelopeShapes), env3(proc.envelopeShapes), env4(proc.envelopeShapes)
 {
 	mseg1.reset();
 	mseg2.reset();
@@ -260,16 +261,14 @@ void AuxSynthVoice::updateParams(int blockSize)
 
 	float dummy;
 	float remainder = std::modf(currentMidiNote, &dummy);
-	auto baseFreq = static_cast<float>(MTS_NoteToFrequency(proc.client, static_cast<char>(currentMidiNote),
-		static_cast<char>(note.midiChannel)));
+	auto baseFreq = proc.tuning.get(static_cast<int>(currentMidiNote), note.midiChannel);
 	if (!proc.auxParams.ignorepb->isOn())
-		baseFreq *= static_cast<float>(std::pow(
-		    1.05946309436f, note.totalPitchbendInSemitones 
-			* (proc.globalParams.pitchbendRange->getUserValue() / 2.0f) 
-			+ remainder));
+		baseFreq *= FastMath<float>::fastExp2((note.totalPitchbendInSemitones
+			* (proc.globalParams.pitchbendRange->getUserValue() / 2.0f)
+			+ remainder) * (1.f / 12.f));
 	baseFreq = juce::jlimit(20.0f, 20000.f,
 			baseFreq * getValue(proc.timbreParams.pitch)
-	        * static_cast<float>(std::pow(2.0f, static_cast<int>(getValue(proc.auxParams.octave)))));
+	        * std::ldexp(1.0f, static_cast<int>(getValue(proc.auxParams.octave))));
 	osc1Note = gin::getMidiNoteFromHertz(baseFreq);
 
 	currentEnv = proc.auxParams.env->getUserValueInt();
@@ -304,7 +303,7 @@ void AuxSynthVoice::updateParams(int blockSize)
 	float n = getValue(proc.auxParams.filtercutoff);
 	n += (curNote.initialNote - 50) * getValue(proc.auxParams.filterkeytrack);
 
-	float f = gin::getMidiNoteInHertz(n);
+	float f = FastMath<float>::noteToHz(n);
 	f = juce::jlimit(4.0f, maxFreq, f);
 
 	float q = gin::Q / (1.0f - (getValue(proc.auxParams.filterres) / 100.0f) * 0.99f);
@@ -26,57 +26,73 @@ void Envelope::noteOff() noexcept
 	}
 }
 
-double Envelope::getValForIdx(double idx, const bool isAttack) const {
-	idx = std::clamp(idx, 0.0, 1.0);
-	const double c = isAttack ? parameters.aCurve : parameters.dRCurve;
-	double cVal;
-	if (isAttack)
-	{
-		if (c > 0) {
-			const int x = std::clamp(static_cast<int>((1 - idx) * 1024.), 0, 1023);
-			const auto l1 = convex[x];
-			const auto l2 = convex[std::min(x + 1, 1023)];
-			const auto frac = (1 - idx) * 1024.0 - std::floor((1 - idx) * 1024.);
-			const auto lookup = (1 - frac) * l1 + frac * l2;
-			cVal = (1 - c) * idx + c * (1 - lookup);
-		}
-		else {
-			const int x = std::clamp(static_cast<int>(idx * 1024.), 0, 1023);
-			const auto l1 = convex[x];
-			const auto l2 = convex[std::min(x + 1, 1023)];
-			const auto frac = idx * 1024.0 - std::floor(idx * 1024.);
-			const auto lookup = (1 - frac) * l1 + frac * l2;
-			cVal = (1 + c) * idx - c * lookup;
-		}
-	}
-	else
+double Envelope::getValForIdx(double idx, const bool isAttack) const
+{
+	return isAttack ? attackAt(idx) : fallAt(idx);
+}
+
+void Envelope::Shapes::build(const std::array<double, 1024> &convex) noexcept
+{
+	// the curve at a setting of c, with c at +1 or -1
+	const auto valueAt = [&convex](const double idx, const double c, const bool isAttack)
 	{
-		if (c < 0)
+		double cVal;
+		if (isAttack)
 		{
-			const int x = std::clamp(static_cast<int>(idx * 1024.), 0, 1023);
-			const auto l1 = convex[x];
-			const auto l2 = convex[std::min(x + 1, 1023)];
-			const auto frac = idx * 1024.0 - std::floor(idx * 1024.);
-			const auto lookup = (1 - frac) * l1 + frac * l2;
-			cVal = (1 + c) * idx - c * lookup;
+			if (c > 0) {
+				const int x = std::clamp(static_cast<int>((1 - idx) * 1024.), 0, 1023);
+				const auto l1 = convex[x];
+				const auto l2 = convex[std::min(x + 1, 1023)];
+				const auto frac = (1 - idx) * 1024.0 - std::floor((1 - idx) * 1024.);
+				const auto lookup = (1 - frac) * l1 + frac * l2;
+				cVal = (1 - c) * idx + c * (1 - lookup);
+			}
+			else {
+				const int x = std::clamp(static_cast<int>(idx * 1024.), 0, 1023);
+				const auto l1 = convex[x];
+				const auto l2 = convex[std::min(x + 1, 1023)];
+				const auto frac = idx * 1024.0 - std::floor(idx * 1024.);
+				const auto lookup = (1 - frac) * l1 + frac * l2;
+				cVal = (1 + c) * idx - c * lookup;
+			}
 		}
-		else {
-			const int x = std::clamp(static_cast<int>((1 - idx) * 1024.), 0, 1023);
-			const auto l1 = 1 - convex[x];
-			const auto l2 = 1 - convex[std::min(x + 1, 1023)];
-			const auto frac = idx * 1024.0 - std::floor(idx * 1024.);
-			const auto lookup = (1 - frac) * l1 + frac * l2;
-			cVal = (1 - c) * idx + c * lookup;
+		else
+		{
+			if (c < 0)
+			{
+				const int x = std::clamp(static_cast<int>(idx * 1024.), 0, 1023);
+				const auto l1 = convex[x];
+				const auto l2 = convex[std::min(x + 1, 1023)];
+				const auto frac = idx * 1024.0 - std::floor(idx * 1024.);
+				const auto lookup = (1 - frac) * l1 + frac * l2;
+				cVal = (1 + c) * idx - c * lookup;
+			}
+			else {
+				const int x = std::clamp(static_cast<int>((1 - idx) * 1024.), 0, 1023);
+				const auto l1 = 1 - convex[x];
+				const auto l2 = 1 - convex[std::min(x + 1, 1023)];
+				const auto frac = idx * 1024.0 - std::floor(idx * 1024.);
+				const auto lookup = (1 - frac) * l1 + frac * l2;
+				cVal = (1 - c) * idx + c * lookup;
+			}
 		}
+		return cVal;
+	};
+	for (int i = 0; i <= points; i++) {
+		const double idx = static_cast<double>(i) / points;
+		const auto n = static_cast<size_t>(i);
+		attackPos[n] = static_cast<float>(valueAt(idx, 1.0, true) - idx);
+		attackNeg[n] = static_cast<float>(idx - valueAt(idx, -1.0, true));
+		fallPos[n] = static_cast<float>(valueAt(idx, 1.0, false) - idx);
+		fallNeg[n] = static_cast<float>(idx - valueAt(idx, -1.0, false));
 	}
-	return cVal;
 }
 
 double Envelope::getIdxForVal(const double val) const
 {
 	double low{0}, high{1}, mid{0.5};
 	constexpr double tol{0.05};
-	double diff = getValForIdx(mid, false) - val;
+	double diff = fallAt(mid) - val;
 	while (std::abs(diff) > tol) {
 		if (diff > 0) {	
 		    high = mid;
@@ -86,7 +102,7 @@ double Envelope::getIdxForVal(const double val) const
 		    low = mid;
 		    mid = (high + low) * 0.5;
 		}
-		diff = getValForIdx(mid, false) - val;
+		diff = fallAt(mid) - val;
 	}
 	return mid;
 }
@@ -105,7 +121,7 @@ float Envelope::getNextSample() noexcept
 		linearIdxVal += attackRate;
 		linearIdxVal = std::clamp(linearIdxVal, 0.0, 1.0);
 
-		finalOut = getValForIdx(linearIdxVal, true);
+		finalOut = attackAt(linearIdxVal);
 		releaseStart = finalOut;  // in case note is released before attack finishes
 
 		if (linearIdxVal >= .999) {
@@ -120,7 +136,7 @@ float Envelope::getNextSample() noexcept
 		linearIdxVal += attackRate;
 		linearIdxVal = std::clamp(linearIdxVal, 0.0, 1.0);
 
-		finalOut = getValForIdx(linearIdxVal, true);
+		finalOut = attackAt(linearIdxVal);
 		releaseStart = finalOut;  // in case note is released before attack finishes
 
 		if (timeSinceStart >= duration) {
@@ -142,7 +158,7 @@ float Envelope::getNextSample() noexcept
 		linearIdxVal -= decayRate;
 		linearIdxVal = std::clamp(linearIdxVal, 0.0, 1.0);
 
-		const auto unmappedVal = getValForIdx(linearIdxVal, false);
+		const double unmappedVal = fallAt(linearIdxVal);
 		finalOut = juce::jmap(unmappedVal, 0.0, 1.0, parameters.sustainLevel, 1.0);
 		releaseStart = finalOut;
 
@@ -156,7 +172,7 @@ float Envelope::getNextSample() noexcept
 		linearIdxVal -= decayRate;
 		linearIdxVal = std::clamp(linearIdxVal, 0.0, 1.0);
 
-		const auto unmappedVal = getValForIdx(linearIdxVal, false);
+		const double unmappedVal = fallAt(linearIdxVal);
 		finalOut = juce::jmap(unmappedVal, 0.0, 1.0, parameters.sustainLevel, 1.0);
 		releaseStart = finalOut;
 
@@ -182,7 +198,7 @@ float Envelope::getNextSample() noexcept
 		linearIdxVal -= releaseRate;
 		linearIdxVal = std::clamp(linearIdxVal, 0.0, 1.0);
 
-		const auto unmappedVal = getValForIdx(linearIdxVal, false);
+		const double unmappedVal = fallAt(linearIdxVal);
 		finalOut = juce::jmap(unmappedVal, 0.0, 1.0, 0.0, releaseStart);
 		if (linearIdxVal <= 0.001f)
 			goToNextState();
@@ -197,7 +213,7 @@ float Envelope::getNextSample() noexcept
 		linearIdxVal -= releaseRate;
 		linearIdxVal = std::clamp(linearIdxVal, 0.0, 0.999);
 
-		const auto unmappedVal = getValForIdx(linearIdxVal, false);
+		const double unmappedVal = fallAt(linearIdxVal);
 		finalOut = juce::jmap(unmappedVal, 0.0, 1.0, 0.0, releaseStart);
 
 		if (timeSinceStart >= duration)
@@ -225,6 +241,26 @@ float Envelope::getNextSample() noexcept
 	return out;  // envelopeVal;
 }
 
+float Envelope::renderBlock(float *dest, const int numSteps) noexcept
+{
+	using Vec = juce::dsp::SIMDRegister<float>;
+	static_assert(Vec::size() == static_cast<size_t>(stepSamples));
+
+	alignas(16) static constexpr float rampValues[stepSamples] = {0.f, .25f, .5f, .75f};
+	const auto ramp = Vec::fromRawArray(rampValues);
+
+	auto level = std::clamp(static_cast<float>(finalOut), 0.0f, 1.0f);
+	float peak = level;
+	for (int i = 0; i < numSteps; i++) {
+		const float next = getNextSample();
+		const auto out = Vec::multiplyAdd(Vec::expand(level), Vec::expand(next - level), ramp);
+		out.copyToRawArray(dest + i * stepSamples);
+		peak = std::max(peak, next);
+		level = next;
+	}
+	return peak;
+}
+
 //==============================================================================
 
 void Envelope::recalculateRates() noexcept
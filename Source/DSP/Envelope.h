@@ -15,18 +15,30 @@
 #pragma once
 
 #include <juce_core/juce_core.h>
+#include <juce_dsp/juce_dsp.h>
+#include <array>
 
 class Envelope {
 public:
 	//==============================================================================
-	explicit Envelope(const std::array<double, 1024>& convex_) : convex(convex_)  {
+	// The attack and decay/release shapes, sampled from the convex table. A
+	// curve setting c gives idx + c * shape(idx), with one shape for c above
+	// zero and one below, so a single set serves every envelope at every
+	// curve setting and modulating the curve never rebuilds anything. The
+	// processor builds it once, before any envelope runs.
+	struct Shapes {
+		static constexpr int points = 1024;
+		using Table = std::array<float, points + 1>;
+		Table attackPos{}, attackNeg{}, fallPos{}, fallNeg{};
+		void build(const std::array<double, 1024> &convex) noexcept;
+	};
+
+	explicit Envelope(const Shapes &shapes_) : shapes(shapes_) {
 		recalculateRates();
 	}
 
 	~Envelope() = default;
 
-	const std::array<double, 1024>& convex;
-
 	//==============================================================================
 	enum class State {
 		idle,
@@ -100,6 +112,12 @@ public:
 	[[nodiscard]] double getIdxForVal(const double val) const;
 
 	float getNextSample() noexcept;
+
+	// Runs numSteps steps and writes numSteps * stepSamples values to dest
+	// (16-byte aligned), ramping linearly from each step's level to the next
+	// instead of holding it. Returns the highest level in the block.
+	static constexpr int stepSamples = 4;
+	float renderBlock(float *dest, int numSteps) noexcept;
 	void advance(const int frames) { for (int i = 0; i < frames; i++) { getNextSample(); } }
 
 private:
@@ -107,8 +125,29 @@ private:
 	void recalculateRates() noexcept;
 	void goToNextState() noexcept;
 
+	[[nodiscard]] static inline float curveAt(const Shapes::Table &shape, const double c, const double idx) noexcept
+	{
+		const auto x = static_cast<float>(std::clamp(idx, 0.0, 1.0));
+		const auto pos = x * Shapes::points;
+		const int i = std::min(static_cast<int>(pos), Shapes::points - 1);
+		const float frac = pos - static_cast<float>(i);
+		const float bend = shape[static_cast<size_t>(i)] + frac * (shape[static_cast<size_t>(i + 1)] - shape[static_cast<size_t>(i)]);
+		return x + static_cast<float>(c) * bend;
+	}
+	[[nodiscard]] inline float attackAt(const double idx) const noexcept
+	{
+		const double c = parameters.aCurve;
+		return curveAt(c > 0 ? shapes.attackPos : shapes.attackNeg, c, idx);
+	}
+	[[nodiscard]] inline float fallAt(const double idx) const noexcept
+	{
+		const double c = parameters.dRCurve;
+		return curveAt(c > 0 ? shapes.fallPos : shapes.fallNeg, c, idx);
+	}
+
 	//==============================================================================
 
+	const Shapes &shapes;
 	State state = State::idle;
 	Params parameters;
 
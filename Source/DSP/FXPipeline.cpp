@@ -0,0 +1,129 @@
+/*
+ * Audible Planets - an expressive, quasi-Ptolemaic semi-modular synthesizer
+ *
+ * Copyright 2024, Greg Recco
+ *
+ * Audible Planets is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * All source for Audible Planets is available at
+ * https://github.com/gregrecco67/AudiblePlanets
+ */
+
+#include "FXPipeline.h"
+#include "AllocationTrap.h"
+#include "SpinWait.h"
+
+namespace {
+// the worker polls for about a block's worth of time before it sleeps
+constexpr int spinsBeforeSleep = 20000;
+}  // namespace
+
+//==============================================================================
+class FXPipeline::Worker final : public juce::Thread {
+public:
+	explicit Worker(FXPipeline &p) : juce::Thread("FX pipeline"), pipeline(p) {}
+
+	void run() override
+	{
+		while (!threadShouldExit()) {
+			const auto done = pipeline.completed.load(std::memory_order_relaxed);
+			if (pipeline.submitted.load(std::memory_order_acquire) == done) {
+				idle();
+				continue;
+			}
+			{
+				const ScopedAllocationTrap trap;
+				pipeline.stage.processSlot(static_cast<int>(done % numSlots));
+			}
+			pipeline.completed.store(done + 1, std::memory_order_release);
+		}
+	}
+
+	void wakeIfSleeping() { wake.notify(); }
+
+	void stop()
+	{
+		signalThreadShouldExit();
+		wake.notify();
+		stopThread(1000);
+	}
+
+private:
+	void idle()
+	{
+		for (int spins = 0; spins < spinsBeforeSleep; spins++) {
+			if (threadShouldExit() || hasWork())
+				return;
+			cpuRelax();
+		}
+		wake.prepareToSleep();
+		if (threadShouldExit() || hasWork())
+			wake.cancelSleep();
+		else
+			wake.sleep();
+	}
+
+	bool hasWork() const
+	{
+		return pipeline.submitted.load(std::memory_order_acquire) != pipeline.completed.load(std::memory_order_relaxed);
+	}
+
+	FXPipeline &pipeline;
+	WakeFlag wake;
+};
+
+//==============================================================================
+FXPipeline::FXPipeline(Stage &s) : stage(s) {}
+
+FXPipeline::~FXPipeline()
+{
+	stop();
+}
+
+void FXPipeline::start()
+{
+	stop();
+	submitted.store(0);
+	completed.store(0);
+	played = 0;
+	worker = std::make_unique<Worker>(*this);
+	worker->startThread(juce::Thread::Priority::highest);
+}
+
+void FXPipeline::stop()
+{
+	if (worker == nullptr)
+		return;
+	worker->stop();
+	worker.reset();
+}
+
+void FXPipeline::flush()
+{
+	if (worker == nullptr)
+		return;
+	const auto s = submitted.load(std::memory_order_relaxed);
+	while (completed.load(std::memory_order_acquire) != s)
+		cpuRelax();
+	played = s;
+}
+
+void FXPipeline::submit()
+{
+	const auto s = submitted.load(std::memory_order_relaxed);
+	// the slot after this one can't still be waiting to be played out
+	jassert(s + 1 - played < numSlots);
+	submitted.store(s + 1, std::memory_order_release);
+	worker->wakeIfSleeping();
+}
+
+int FXPipeline::waitForPlayable()
+{
+	jassert(played < submitted.load(std::memory_order_relaxed));
+	while (completed.load(std::memory_order_acquire) <= played)
+		cpuRelax();
+	return static_cast<int>(played % numSlots);
+}
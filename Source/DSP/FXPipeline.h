@@ -0,0 +1,71 @@
+/*
+ * Audible Planets - an expressive, quasi-Ptolemaic semi-modular synthesizer
+ *
+ * Copyright 2024, Greg Recco
+ *
+ * Audible Planets is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * All source for Audible Planets is available at
+ * https://github.com/gregrecco67/AudiblePlanets
+ */
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+//==============================================================================
+// Runs a stage of the processing one block behind the audio thread, on a
+// thread of its own. The audio thread fills slots in turn and submits them,
+// the worker processes them in order, and the audio thread only waits when
+// it comes to play out a slot the worker hasn't finished. Three slots go
+// round: one filling, one being processed, one being played out. What a
+// slot holds is up to the Stage; this only hands out indices. The counters
+// are a single-producer, single-consumer ring, so there are no locks or
+// allocations once the worker is running.
+class FXPipeline {
+public:
+	static constexpr int numSlots = 3;
+
+	struct Stage {
+		virtual ~Stage() = default;
+		// on the worker, for each submitted slot in turn
+		virtual void processSlot(int slot) = 0;
+	};
+
+	explicit FXPipeline(Stage &s);
+	~FXPipeline();
+
+	// with the audio thread stopped; start() forgets any slots in flight
+	void start();
+	void stop();
+	[[nodiscard]] bool isRunning() const { return worker != nullptr; }
+
+	// with the audio thread stopped: lets the worker finish the slot it's
+	// on, then drops every slot not yet played out. The thread keeps running
+	void flush();
+
+	// audio thread: the slot to fill, and handing it over once it's full
+	[[nodiscard]] int getFillingSlot() const { return static_cast<int>(submitted.load(std::memory_order_relaxed) % numSlots); }
+	void submit();
+
+	// audio thread: the oldest slot not yet played out, waiting for the
+	// worker if need be; release() once it's all been played
+	int waitForPlayable();
+	void release() { ++played; }
+
+private:
+	class Worker;
+
+	Stage &stage;
+	std::unique_ptr<Worker> worker;
+	std::atomic<uint64_t> submitted{0}, completed{0};
+	uint64_t played{0};  // audio thread only
+
+	JUCE_DECLARE_NON_COPYABLE(FXPipeline)
+};
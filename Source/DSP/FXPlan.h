@@ -0,0 +1,90 @@
+/*
+ * Audible Planets - an expressive, quasi-Ptolemaic semi-modular synthesizer
+ *
+ * Copyright 2024, Greg Recco
+ *
+ * Audible Planets is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * All source for Audible Planets is available at
+ * https://github.com/gregrecco67/AudiblePlanets
+ */
+
+
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+class APAudioProcessor;
+
+//==============================================================================
+// What applyEffects runs, in order: lane filters, the effects in the slots
+// and, for parallel routing, the copy into lane B and the mix back. It is
+// compiled from the FX order params off the audio thread, so the audio
+// thread only walks the steps; empty slots never make it in.
+struct FXPlan {
+	// buffer is the lane the step is bound to; other is the other lane,
+	// which only the parallel copy and mix look at
+	using Run = void (*)(APAudioProcessor &, juce::AudioBuffer<float> &buffer, juce::AudioBuffer<float> &other);
+
+	enum Lane : uint8_t { laneA, laneB };
+
+	struct Step {
+		Run run{nullptr};
+		Lane lane{laneA};
+	};
+
+	// 8 effect slots, a pre or post filter per lane, the copy and the mix
+	static constexpr int maxSteps = 12;
+	std::array<Step, maxSteps> steps{};
+	int numSteps{0};
+
+	void add(const Run run, const Lane lane)
+	{
+		jassert(numSteps < maxSteps);
+		steps[static_cast<size_t>(numSteps++)] = {run, lane};
+	}
+
+	// bit n set when effect n (as in the fxa1..fxb4 choices) is in a slot
+	uint32_t activeEffects{0};
+	[[nodiscard]] bool isActive(const int effect) const { return (activeEffects >> effect) & 1u; }
+
+	float laneGainScale{1.f};  // parallel lanes are summed, at half gain each
+	int laneAType{0}, laneBType{0};  // lane filter types, as SynthVoice3::setFilterType takes them
+};
+
+//==============================================================================
+// Passes plans from the message thread to the audio thread without locks or
+// allocation: three slots, one the audio thread reads, one the message
+// thread writes and one in between, which the two swap with atomically.
+class FXPlanExchange {
+public:
+	// message thread: fill in the plan edit() returns, then publish() it
+	FXPlan &edit() { return slots[static_cast<size_t>(back)]; }
+	void publish()
+	{
+		back = middle.exchange(back | fresh, std::memory_order_acq_rel) & indexMask;
+	}
+
+	// audio thread, once per block: takes the latest plan if there's a new
+	// one, and says so
+	bool update()
+	{
+		if ((middle.load(std::memory_order_relaxed) & fresh) == 0)
+			return false;
+		front = middle.exchange(front, std::memory_order_acq_rel) & indexMask;
+		return true;
+	}
+	[[nodiscard]] const FXPlan &get() const { return slots[static_cast<size_t>(front)]; }
+
+private:
+	static constexpr int indexMask = 3, fresh = 4;
+	std::array<FXPlan, 3> slots;
+	int front{0}, back{1};
+	std::atomic<int> middle{2};
+};
@@ -23,14 +23,17 @@
 #include "ADAAsrc/TanhNL.h"
 #include "FastMath.hpp"
 #include "LFO.h"
+#include "ScratchArena.h"
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <cmath>
 #include <gin_dsp/gin_dsp.h>
 #include <juce_core/juce_core.h>
 #include <juce_dsp/juce_dsp.h>
 #include <memory>
+#include <vector>
 
-#define MINI_BLOCK_SIZE 32
 #define C5_95 (-0.017005f)
 #define C5_m95 0.017005f
 
@@ -46,15 +49,15 @@
 
 class ChorusProcessor {
 public:
+  using SIMD = juce::dsp::SIMDRegister<float>;
+  static_assert(SIMD::size() == 4);
+
   ChorusProcessor() = default;
   ~ChorusProcessor() = default;
 
 public:
   void prepare(juce::dsp::ProcessSpec spec) {
     currentSampleRate = static_cast<float>(spec.sampleRate);
-    centerDelayBuffer.setSize(1, 1.0, currentSampleRate);
-    leftDelayBuffer.setSize(1, 1.0, currentSampleRate);
-    rightDelayBuffer.setSize(1, 1.0, currentSampleRate);
     lfo.setSampleRate(currentSampleRate);
     lfo.setFrequency(15.0f);
     lfo.initialize();
@@ -62,51 +65,37 @@ public:
     delayTime_ms.setCurrentAndTargetValue(15.0f);
     depth.reset(currentSampleRate, 0.035f);
     depth.setCurrentAndTargetValue(0.5f);
+
+    // The three delays share one ring of {left, centre, right, unused}
+    // frames, long enough for the longest delay and the interpolator's
+    // reach past it.
+    const int longest =
+        static_cast<int>(std::ceil(maxDelay_ms * 0.001f * currentSampleRate));
+    numFrames = juce::nextPowerOfTwo(longest + 4);
+    frames.reserve(4 * static_cast<size_t>(numFrames));
+    ring = frames.take(4 * static_cast<size_t>(numFrames));
+    writeIdx = 0;
+
+    // A block's reads all come from before its first write, so a block
+    // can't be longer than the shortest delay less the interpolator's reach.
+    const int shortest =
+        static_cast<int>(minDelay_ms * 0.001f * currentSampleRate);
+    blockSize = std::clamp(shortest - 2, 1, maxBlockSize);
   }
 
   void process(const juce::dsp::ProcessContextReplacing<float> &context) {
     //
     const auto &inBlock = context.getOutputBlock();
 
-    const auto numSamples = inBlock.getNumSamples();
+    const auto numSamples = static_cast<int>(inBlock.getNumSamples());
     const auto samplesL = inBlock.getChannelPointer(0);
     const auto samplesR = inBlock.getChannelPointer(1);
 
     lfo.setFrequency(lfoRate);
-    for (int i = 0; i < static_cast<int>(numSamples); i++) {
-      const auto lfoValues = lfo.getNextValues();
-      const auto leftDelayTime_ms =
-          std::clamp((lfoValues.deg0Value * 10.0f * depth.getNextValue()) +
-                         delayTime_ms.getNextValue(),
-                     5.f, 40.f);
-      const auto centerDelayTime_ms =
-          std::clamp((lfoValues.deg120Value * 10.0f * depth.getNextValue()) +
-                         delayTime_ms.getNextValue(),
-                     5.f, 40.f);
-      const auto rightDelayTime_ms =
-          std::clamp((lfoValues.deg240Value * 10.0f * depth.getNextValue()) +
-                         delayTime_ms.getNextValue(),
-                     5.f, 40.f);
-
-      const auto leftIn = samplesL[i];
-      const auto rightIn = samplesR[i];
-      const auto leftChorusOut =
-          leftDelayBuffer.readLagrange(0, leftDelayTime_ms / 1000.0f);
-      const auto centerChorusOut =
-          centerDelayBuffer.readLagrange(0, centerDelayTime_ms / 1000.0f);
-      const auto rightChorusOut =
-          rightDelayBuffer.readLagrange(0, rightDelayTime_ms / 1000.0f);
-
-      leftDelayBuffer.write(0, leftIn + leftChorusOut * feedback);
-      centerDelayBuffer.write(0, rightIn * 0.5f + leftIn * 0.5f +
-                                     centerChorusOut * feedback);
-      rightDelayBuffer.write(0, rightIn + rightChorusOut * feedback);
-      leftDelayBuffer.writeFinished();
-      centerDelayBuffer.writeFinished();
-      rightDelayBuffer.writeFinished();
-
-      samplesL[i] = (leftChorusOut + centerChorusOut) * wet + dry * leftIn;
-      samplesR[i] = (centerChorusOut + rightChorusOut) * wet + dry * rightIn;
+    for (int done = 0; done < numSamples;) {
+      const int n = std::min(numSamples - done, blockSize);
+      processBlock(samplesL + done, samplesR + done, n);
+      done += n;
     }
   }
 
@@ -125,11 +114,76 @@ public:
   }
 
 private:
+  static constexpr int maxBlockSize = 32;
+  static constexpr float minDelay_ms = 5.f, maxDelay_ms = 40.f;
+
+  // The left, centre and right voices go through the lanes together: the
+  // LFO for the whole block first, then the delay times, the reads and the
+  // writes, one register per sample.
+  void processBlock(float *samplesL, float *samplesR, const int n) {
+    SIMD delays[maxBlockSize];
+    lfo.getNextBlock(delays, n);
+
+    const SIMD shortest{minDelay_ms}, longest{maxDelay_ms};
+    const SIMD msToSamples{0.001f * currentSampleRate};
+    for (int i = 0; i < n; i++) {
+      const float swing = 10.0f * depth.getNextValue();
+      const SIMD centre{delayTime_ms.getNextValue()};
+      delays[i] = SIMD::min(SIMD::max(delays[i] * swing + centre, shortest),
+                            longest) *
+                  msToSamples;
+    }
+
+    alignas(16) float taps[maxBlockSize * 4];
+    for (int i = 0; i < n; i++)
+      readLagrange(delays[i], writeIdx + i).copyToRawArray(taps + 4 * i);
+
+    const SIMD fb{feedback};
+    for (int i = 0; i < n; i++) {
+      const float leftIn = samplesL[i], rightIn = samplesR[i];
+      alignas(16) const float in[4]{leftIn, rightIn * 0.5f + leftIn * 0.5f,
+                                    rightIn, 0.f};
+      const auto frame = (writeIdx + i) & (numFrames - 1);
+      (SIMD::fromRawArray(in) + SIMD::fromRawArray(taps + 4 * i) * fb)
+          .copyToRawArray(ring + 4 * frame);
+
+      const float *tap = taps + 4 * i;
+      samplesL[i] = (tap[0] + tap[1]) * wet + dry * leftIn;
+      samplesR[i] = (tap[1] + tap[2]) * wet + dry * rightIn;
+    }
+    writeIdx = (writeIdx + n) & (numFrames - 1);
+  }
+
+  // Third-order Lagrange interpolation of each lane, `delays` samples
+  // before frame `at` was written. The four points are gathered lane by
+  // lane, and the weights and the sum are worked out in the lanes.
+  SIMD readLagrange(const SIMD delays, const int at) const {
+    alignas(16) float d[4], t[4], points[4][4];
+    delays.copyToRawArray(d);
+    for (int lane = 0; lane < 4; lane++) {
+      const int whole = static_cast<int>(d[lane]);
+      t[lane] = 1.f - (d[lane] - static_cast<float>(whole));
+      const int base = at - whole - 2;
+      for (int k = 0; k < 4; k++)
+        points[k][lane] = ring[4 * ((base + k) & (numFrames - 1)) + lane];
+    }
+
+    const SIMD x = SIMD::fromRawArray(t), one{1.f}, two{2.f};
+    const SIMD xm1 = x - one, xm2 = x - two, xp1 = x + one;
+    const SIMD a = x * xm1, b = xp1 * xm2;
+    return a * xm2 * SIMD(-1.f / 6.f) * SIMD::fromRawArray(points[0]) +
+           b * xm1 * SIMD(0.5f) * SIMD::fromRawArray(points[1]) +
+           b * x * SIMD(-0.5f) * SIMD::fromRawArray(points[2]) +
+           a * xp1 * SIMD(1.f / 6.f) * SIMD::fromRawArray(points[3]);
+  }
+
   float lfoRate{0.05f}, feedback{0.0f}, dry{0.5f}, wet{0.5f};
   juce::LinearSmoothedValue<float> delayTime_ms, depth;
   LFO lfo;
   float currentSampleRate = 44100.f;
-  gin::DelayLine centerDelayBuffer{1}, leftDelayBuffer{1}, rightDelayBuffer{1};
+  ScratchArena frames;
+  float *ring{nullptr};
+  int numFrames{0}, writeIdx{0}, blockSize{1};
 };
 
 class StereoDelayProcessor {
@@ -137,14 +191,16 @@ public:
   StereoDelayProcessor() = default;
   ~StereoDelayProcessor() = default;
 
-  void prepare(juce::dsp::ProcessSpec spec) {
-    const auto sampleRate = spec.sampleRate;
+  // Off the audio thread. Sizes the delay memory for longestTime, the
+  // longest of the delay times the caller expects to play, and frees
+  // whatever more it had grown to.
+  void prepare(juce::dsp::ProcessSpec spec, const float longestTime) {
+    sampleRate = spec.sampleRate;
 
     delayTimeL.reset(sampleRate, .015f);
     delayTimeR.reset(sampleRate, .015f);
     cutoff.reset(sampleRate, .025f);
-    delayBuffer_L.setSize(1, 65.0, sampleRate);
-    delayBuffer_R.setSize(1, 65.0, sampleRate);
+    allocate(segmentsFor(longestTime));
     LPFilter.prepare(spec);
     cutoff.setCurrentAndTargetValue(2000.f);
     LPFilter.setCutoffFrequency(cutoff.getNextValue());
@@ -162,57 +218,38 @@ public:
     cutoff.skip(std::min(numSamples - 1, 0));
     LPFilter.setCutoffFrequency(cutoff.getNextValue());
     delayFB = freeze ? 1.0f : delayFB;
-    if (ping) {
-      for (int i = 0; i < numSamples; i++) {
-        const auto dTimeL = std::min(delayTimeL.getNextValue(), 64.0f);
-        const auto dTimeR = std::min(delayTimeR.getNextValue(), 64.0f);
-
-        const float delayedSample_L = delayBuffer_L.readLagrange(0, dTimeL);
-        const float delayedSample_R = delayBuffer_R.readLagrange(0, dTimeR);
-        const float inDelay_L =
-            leftSamples[i] * freezeFactor + delayedSample_R * delayFB;
-        const float inDelay_R =
-            rightSamples[i] * freezeFactor + delayedSample_L * delayFB;
-
-        leftSamples[i] = delayedSample_L * delayWet + leftSamples[i] * delayDry;
-        rightSamples[i] =
-            delayedSample_R * delayWet + rightSamples[i] * delayDry;
-        delayBuffer_L.write(0, LPFilter.processSample(0, inDelay_L));
-        delayBuffer_R.write(0, LPFilter.processSample(1, inDelay_R));
-        delayBuffer_L.writeFinished();
-        delayBuffer_R.writeFinished();
-      }
-    } else {
-      for (int i = 0; i < numSamples; i++) {
-        const auto dTimeL = std::min(delayTimeL.getNextValue(), 64.0f);
-        const auto dTimeR = std::min(delayTimeR.getNextValue(), 64.0f);
-
-        const float delayedSample_L = delayBuffer_L.readLagrange(0, dTimeL);
-        const float delayedSample_R = delayBuffer_R.readLagrange(0, dTimeR);
-        const float inDelay_L =
-            leftSamples[i] * freezeFactor + delayedSample_L * delayFB;
-        const float inDelay_R =
-            rightSamples[i] * freezeFactor + delayedSample_R * delayFB;
-
-        leftSamples[i] = delayedSample_L * delayWet + leftSamples[i] * delayDry;
-        rightSamples[i] =
-            delayedSample_R * delayWet + rightSamples[i] * delayDry;
-        delayBuffer_L.write(0, LPFilter.processSample(0, inDelay_L));
-        delayBuffer_R.write(0, LPFilter.processSample(1, inDelay_R));
-        delayBuffer_L.writeFinished();
-        delayBuffer_R.writeFinished();
-      }
+
+    // Chunks end where segments do, the only place new memory can go in.
+    for (int done = 0; done < numSamples;) {
+      const int n = std::min(numSamples - done,
+                             segmentSize - (writePos & (segmentSize - 1)));
+      if (ping)
+        processChunk<true>(leftSamples + done, rightSamples + done, n,
+                           freezeFactor);
+      else
+        processChunk<false>(leftSamples + done, rightSamples + done, n,
+                            freezeFactor);
+      done += n;
+      if ((writePos & (segmentSize - 1)) == 0)
+        takeNewSegments();
     }
   }
+
   inline void setDry(float dry) { delayDry = dry; }
 
   inline void setWet(float wet) { delayWet = wet; }
 
   inline void setFB(float fb) { delayFB = fb; }
 
-  inline void setTimeL(float time) { delayTimeL.setTargetValue(time); }
+  inline void setTimeL(float time) {
+    delayTimeL.setTargetValue(time);
+    reserveFor(time);
+  }
 
-  inline void setTimeR(float time) { delayTimeR.setTargetValue(time); }
+  inline void setTimeR(float time) {
+    delayTimeR.setTargetValue(time);
+    reserveFor(time);
+  }
 
   inline void setFreeze(bool _freeze) { freeze = _freeze; }
 
@@ -221,20 +258,176 @@ public:
   inline void setCutoff(float _cutoff) { cutoff.setTargetValue(_cutoff); }
 
   void resetBuffers() {
-    delayBuffer_L.clear();
-    delayBuffer_R.clear();
+    for (int s = 0; s < numSegments; s++)
+      std::fill_n(segments[s], 2 * segmentSize, 0.f);
     cutoff.setCurrentAndTargetValue(cutoff.getTargetValue());
     delayTimeL.setCurrentAndTargetValue(delayTimeL.getTargetValue());
     delayTimeR.setCurrentAndTargetValue(delayTimeR.getTargetValue());
   }
 
+  // Whether a delay time has gone past what the memory holds. Safe on any
+  // thread; the processor polls it and has the message thread call grow(),
+  // or calls it itself when rendering offline.
+  [[nodiscard]] bool needsMoreMemory() const {
+    return wantedSegments.load(std::memory_order_relaxed) >
+           allocatedSegments.load(std::memory_order_relaxed);
+  }
+
+  // Allocates what the delay times call for, up to the cap, and leaves it
+  // for the audio thread to splice in. From the message thread, or from the
+  // audio thread when nothing is real time; if both try at once, one skips.
+  void grow() {
+    const juce::SpinLock::ScopedTryLockType lock(growLock);
+    if (!lock.isLocked())
+      return;
+    if (pendingCount.load(std::memory_order_acquire) != 0)
+      return; // the last lot hasn't gone in yet; it'll ask again
+    const int have = allocatedSegments.load(std::memory_order_relaxed);
+    const int more = wantedSegments.load(std::memory_order_relaxed) - have;
+    if (more <= 0)
+      return;
+    for (int s = 0; s < more; s++)
+      pending[s] = newSegment();
+    allocatedSegments.store(have + more, std::memory_order_relaxed);
+    pendingCount.store(more, std::memory_order_release);
+  }
+
+  [[nodiscard]] size_t getNumBytesAllocated() const {
+    return storage.size() * 2 * segmentSize * sizeof(float);
+  }
+
 private:
+  // The delay memory is a ring of segments, each holding segmentSize
+  // samples of both channels. It grows by splicing fresh, silent segments
+  // in just ahead of the write position: what has been written keeps its
+  // place behind it, so growing never has to copy, and the new memory
+  // reads back as silence older than anything there.
+  static constexpr int segmentBits = 12, segmentSize = 1 << segmentBits;
+  static constexpr size_t maxBytes = 16 << 20; // per instance
+  static constexpr int maxSegments =
+      static_cast<int>(maxBytes / (2 * segmentSize * sizeof(float)));
+
+  template <bool pingPong>
+  void processChunk(float *leftSamples, float *rightSamples, const int n,
+                    const float freezeFactor) {
+    // the longest delay the ring can hold, with room for the interpolator
+    const float longest = static_cast<float>(length - 4);
+    float *const segment = segments[writePos >> segmentBits];
+    const int offset = writePos & (segmentSize - 1);
+    for (int i = 0; i < n; i++) {
+      const auto dTimeL = std::clamp(
+          delayTimeL.getNextValue() * static_cast<float>(sampleRate), 3.f,
+          longest);
+      const auto dTimeR = std::clamp(
+          delayTimeR.getNextValue() * static_cast<float>(sampleRate), 3.f,
+          longest);
+
+      const float delayedSample_L = readLagrange(0, dTimeL, i);
+      const float delayedSample_R = readLagrange(1, dTimeR, i);
+      const float inDelay_L =
+          leftSamples[i] * freezeFactor +
+          (pingPong ? delayedSample_R : delayedSample_L) * delayFB;
+      const float inDelay_R =
+          rightSamples[i] * freezeFactor +
+          (pingPong ? delayedSample_L : delayedSample_R) * delayFB;
+
+      leftSamples[i] = delayedSample_L * delayWet + leftSamples[i] * delayDry;
+      rightSamples[i] =
+          delayedSample_R * delayWet + rightSamples[i] * delayDry;
+      segment[offset + i] = LPFilter.processSample(0, inDelay_L);
+      segment[segmentSize + offset + i] = LPFilter.processSample(1, inDelay_R);
+    }
+    writePos += n;
+    if (writePos == length)
+      writePos = 0;
+  }
+
+  // Third-order Lagrange interpolation, delay samples before sample i of
+  // the chunk is written.
+  float readLagrange(const int channel, const float delay, const int i) const {
+    const int whole = static_cast<int>(delay);
+    const float t = 1.f - (delay - static_cast<float>(whole));
+    int pos = writePos + i - whole - 2;
+    if (pos < 0)
+      pos += length;
+
+    float y[4];
+    for (auto &point : y) {
+      point = segments[pos >> segmentBits][channel * segmentSize +
+                                           (pos & (segmentSize - 1))];
+      if (++pos == length)
+        pos = 0;
+    }
+    const float a = t * (t - 1.f), b = (t + 1.f) * (t - 2.f);
+    return a * (t - 2.f) * (-1.f / 6.f) * y[0] + b * (t - 1.f) * 0.5f * y[1] +
+           b * t * -0.5f * y[2] + a * (t + 1.f) * (1.f / 6.f) * y[3];
+  }
+
+  // Enough segments for a delay of the given length, with some headroom
+  // so a sweep upwards doesn't ask for more every few milliseconds.
+  [[nodiscard]] int segmentsFor(const float seconds) const {
+    const double samples = 1.25 * seconds * sampleRate + 4.0;
+    return std::clamp(static_cast<int>(samples / segmentSize) + 1, 1,
+                      maxSegments);
+  }
+
+  void reserveFor(const float seconds) {
+    const int wanted = segmentsFor(seconds);
+    if (wanted > wantedSegments.load(std::memory_order_relaxed))
+      wantedSegments.store(wanted, std::memory_order_relaxed);
+  }
+
+  // Audio thread, at a segment boundary: splices in whatever grow() left.
+  void takeNewSegments() {
+    const int more = pendingCount.load(std::memory_order_acquire);
+    if (more == 0)
+      return;
+    const int at = writePos >> segmentBits;
+    std::copy_backward(segments.begin() + at, segments.begin() + numSegments,
+                       segments.begin() + numSegments + more);
+    std::copy_n(pending.begin(), more, segments.begin() + at);
+    numSegments += more;
+    length = numSegments * segmentSize;
+    pendingCount.store(0, std::memory_order_release);
+  }
+
+  float *newSegment() {
+    storage.push_back(std::make_unique<float[]>(2 * segmentSize));
+    return storage.back().get();
+  }
+
+  void allocate(const int count) {
+    storage.clear();
+    storage.reserve(maxSegments);
+    for (int s = 0; s < count; s++)
+      segments[s] = newSegment();
+    numSegments = count;
+    length = numSegments * segmentSize;
+    writePos = 0;
+    pendingCount.store(0);
+    wantedSegments.store(count);
+    allocatedSegments.store(count);
+  }
+
   float delayDry{1.0f}, delayWet{0.5f}, delayFB{0.5f};
   juce::LinearSmoothedValue<float> delayTimeL{.40f}, delayTimeR{.40f},
       cutoff{2000.f};
-  gin::DelayLine delayBuffer_L{1}, delayBuffer_R{1};
   bool freeze{false}, ping{true};
   juce::dsp::StateVariableTPTFilter<float> LPFilter;
+  double sampleRate{44100.0};
+
+  // the ring, in order; only the thread running the delay touches it
+  std::array<float *, maxSegments> segments{};
+  int numSegments{0}, length{0}, writePos{0};
+
+  // owns every segment until the next prepare; grow() holds growLock
+  std::vector<std::unique_ptr<float[]>> storage;
+  juce::SpinLock growLock;
+
+  // grow() fills pending and publishes the count; the audio thread takes
+  // them and sets it back to zero
+  std::array<float *, maxSegments> pending{};
+  std::atomic<int> pendingCount{0}, wantedSegments{0}, allocatedSegments{0};
 };
 
 /// PlateReverb license info:
@@ -285,14 +478,20 @@ SOFTWARE.
 
 template <class F, class I> class PlateReverb {
 public:
+  static_assert(std::is_same_v<F, float>, "the delay lines are ScratchArena floats");
+
   static constexpr F kMaxPredelay = 0.1f; // seconds
   static constexpr F kMaxSize = 3.0f;
 
+  // The reverb runs a block of at most this many samples through each stage
+  // before moving on to the next.
+  static constexpr I kBlockSize = 64;
+
   PlateReverb() = default;
   ~PlateReverb() = default;
 
-  // Set the sample rate.  Note that we are re-mallocing all of the various
-  // delay lines here.
+  // Set the sample rate.  Note that we are re-sizing all of the various
+  // delay lines here, which can reallocate the block they share.
   void setSampleRate(F sampleRate_) {
     sampleRate = sampleRate_;
 
@@ -301,8 +500,7 @@ public:
     F r = sampleRate / 29761.0f;
 
     // Predelay
-    predelayLine.reset(
-        new DelayLine((uint32_t)std::ceil(sampleRate * kMaxPredelay)));
+    predelayLine.setSize((uint32_t)std::ceil(sampleRate * kMaxPredelay));
 
     // Lowpass filters
     lowpass.setSampleRate(sampleRate);
@@ -310,10 +508,10 @@ public:
     rightTank.damping.setSampleRate(sampleRate);
 
     // Diffusers
-    diffusers[0].reset(new DelayAllpass((uint32_t)std::ceil(142 * r), 0.75));
-    diffusers[1].reset(new DelayAllpass((uint32_t)std::ceil(107 * r), 0.75));
-    diffusers[2].reset(new DelayAllpass((uint32_t)std::ceil(379 * r), 0.625));
-    diffusers[3].reset(new DelayAllpass((uint32_t)std::ceil(277 * r), 0.625));
+    diffusers[0].setSize((uint32_t)std::ceil(142 * r), 0.75);
+    diffusers[1].setSize((uint32_t)std::ceil(107 * r), 0.75);
+    diffusers[2].setSize((uint32_t)std::ceil(379 * r), 0.625);
+    diffusers[3].setSize((uint32_t)std::ceil(277 * r), 0.625);
 
     // Tanks
     F maxModDepth = 8.0f * kMaxSize * r;
@@ -332,6 +530,15 @@ public:
         (uint32_t)std::ceil(kMaxSize * 3163 * r)        // del2
     );
 
+    // All the lines live in one block, laid out in the order the signal
+    // goes through them.
+    size_t numFloats = 0;
+    forEachLine([&](DelayLine &line) {
+      numFloats += ScratchArena::footprint(line.getLength());
+    });
+    lineArena.reserve(numFloats);
+    forEachLine([&](DelayLine &line) { line.allocate(lineArena); });
+
     leftTank.lfo.setSampleRate(sampleRate);
     rightTank.lfo.setSampleRate(sampleRate);
     leftTank.lfo.setFrequency(1.0);
@@ -409,6 +616,21 @@ public:
     rightTank.damping.setCutoff(cutoff);
   }
 
+  // What the delay lines take up, for the memory diagnostics.
+  struct MemoryStats {
+    size_t numLines = 0;
+    size_t bytesUsed = 0;     // the lines, padding included
+    size_t bytesReserved = 0; // the block they share
+  };
+
+  MemoryStats getMemoryStats() const {
+    MemoryStats stats;
+    stats.numLines = kNumLines;
+    stats.bytesUsed = lineArena.getNumFloatsUsed() * sizeof(F);
+    stats.bytesReserved = lineArena.getCapacity() * sizeof(F);
+    return stats;
+  }
+
   void prepare(juce::dsp::ProcessSpec spec) {
     sampleRate = (float)spec.sampleRate;
     setSampleRate(sampleRate);
@@ -418,62 +640,93 @@ public:
   void process(const juce::dsp::ProcessContextReplacing<float> &context) {
     const auto &inBlock = context.getOutputBlock();
 
-    const auto numSamples = inBlock.getNumSamples();
-    auto outLeft = inBlock.getChannelPointer(0);
-    auto outRight = inBlock.getChannelPointer(1);
-    auto inLeft = inBlock.getChannelPointer(0);
-    auto inRight = inBlock.getChannelPointer(1);
-    for (int i = 0; i < static_cast<int>(numSamples); i++) {
-      process(inLeft[i], inRight[i], &outLeft[i], &outRight[i]);
+    const auto numSamples = static_cast<I>(inBlock.getNumSamples());
+    auto left = inBlock.getChannelPointer(0);
+    auto right = inBlock.getChannelPointer(1);
+    for (I done = 0; done < numSamples;) {
+      const I n = std::min({numSamples - done, kBlockSize,
+                            leftTank.getMaxBlockSize(),
+                            rightTank.getMaxBlockSize()});
+      processBlock(left + done, right + done, n);
+      done += n;
     }
   }
 
-  // Process a stereo pair of samples.
-  void process(F dryLeft, F dryRight, F *leftOut, F *rightOut) {
-    // ---------------------
+  // Process a block of stereo samples in place, one stage at a time. Every
+  // delay that isn't modulated is read back as a contiguous run, so the
+  // taps, delays and allpasses are all plain loops over the block.
+  void processBlock(F *left, F *right, I n) {
+    jassert(n <= kBlockSize);
 
     // Note that this is "synthetic stereo".  We produce a stereo pair
     // of output samples based on the summed input.
-    F sum = dryLeft + dryRight;
+    F sum[kBlockSize];
+    for (I i = 0; i < n; ++i)
+      sum[i] = left[i] + right[i];
 
     // Predelay
-    sum = predelayLine->tapAndPush(predelay, sum);
+    predelayLine.push(sum, n);
+    predelayLine.tap(predelay, sum, n, n);
 
     // Input lowpass
-    sum = lowpass.process(sum);
+    for (I i = 0; i < n; ++i)
+      sum[i] = lowpass.process(sum[i]);
 
     // Diffusers
-    sum = diffusers[0]->process(sum, diffusers[0]->getSize());
-    sum = diffusers[1]->process(sum, diffusers[1]->getSize());
-    sum = diffusers[2]->process(sum, diffusers[2]->getSize());
-    sum = diffusers[3]->process(sum, diffusers[3]->getSize());
-
-    // Tanks
-    F leftIn = sum + rightTank.out * decayRate;
-    F rightIn = sum + leftTank.out * decayRate;
-    leftTank.process(leftIn);
-    rightTank.process(rightIn);
+    for (auto &diffuser : diffusers)
+      diffuser.process(sum, (F)diffuser.getSize(), n);
+
+    // Tanks. Each one is fed the other's output from a sample before, and
+    // a block's worth of those outputs is already in del2 (see
+    // Tank::getMaxBlockSize()), so both can be read before either runs.
+    F leftOut[kBlockSize], rightOut[kBlockSize];
+    leftTank.readOutputs(leftOut, n);
+    rightTank.readOutputs(rightOut, n);
+
+    F leftIn[kBlockSize], rightIn[kBlockSize];
+    leftIn[0] = sum[0] + rightTank.out * decayRate;
+    rightIn[0] = sum[0] + leftTank.out * decayRate;
+    for (I i = 1; i < n; ++i) {
+      leftIn[i] = sum[i] + rightOut[i - 1] * decayRate;
+      rightIn[i] = sum[i] + leftOut[i - 1] * decayRate;
+    }
+    leftTank.out = leftOut[n - 1];
+    rightTank.out = rightOut[n - 1];
+
+    // The damping filters are the one step that has to go a sample at a
+    // time, so the two tanks' filters run side by side in one loop.
+    leftTank.processInput(leftIn, n);
+    rightTank.processInput(rightIn, n);
+    for (I i = 0; i < n; ++i) {
+      leftIn[i] = leftTank.damping.process(leftIn[i]) * decayRate;
+      rightIn[i] = rightTank.damping.process(rightIn[i]) * decayRate;
+    }
+    leftTank.processOutput(leftIn, n);
+    rightTank.processOutput(rightIn, n);
 
     // Tap for output
-    F wetLeft = rightTank.del1->tap(leftTaps[0])   //  266
-                + rightTank.del1->tap(leftTaps[1]) // 2974
-                - rightTank.apf2->tap(leftTaps[2]) // 1913
-                + rightTank.del2->tap(leftTaps[3]) // 1996
-                - leftTank.del1->tap(leftTaps[4])  // 1990
-                - leftTank.apf2->tap(leftTaps[5])  //  187
-                - leftTank.del2->tap(leftTaps[6]); // 1066
-
-    F wetRight = leftTank.del1->tap(rightTaps[0])     //  353
-                 + leftTank.del1->tap(rightTaps[1])   // 3627
-                 - leftTank.apf2->tap(rightTaps[2])   // 1228
-                 + leftTank.del2->tap(rightTaps[3])   // 2673
-                 - rightTank.del1->tap(rightTaps[4])  // 2111
-                 - rightTank.apf2->tap(rightTaps[5])  //  335
-                 - rightTank.del2->tap(rightTaps[6]); //  121
+    F wetLeft[kBlockSize] = {}, wetRight[kBlockSize] = {};
+    mixTap(rightTank.del1, leftTaps[0], 1, wetLeft, n);  //  266
+    mixTap(rightTank.del1, leftTaps[1], 1, wetLeft, n);  // 2974
+    mixTap(rightTank.apf2, leftTaps[2], -1, wetLeft, n); // 1913
+    mixTap(rightTank.del2, leftTaps[3], 1, wetLeft, n);  // 1996
+    mixTap(leftTank.del1, leftTaps[4], -1, wetLeft, n);  // 1990
+    mixTap(leftTank.apf2, leftTaps[5], -1, wetLeft, n);  //  187
+    mixTap(leftTank.del2, leftTaps[6], -1, wetLeft, n);  // 1066
+
+    mixTap(leftTank.del1, rightTaps[0], 1, wetRight, n);   //  353
+    mixTap(leftTank.del1, rightTaps[1], 1, wetRight, n);   // 3627
+    mixTap(leftTank.apf2, rightTaps[2], -1, wetRight, n);  // 1228
+    mixTap(leftTank.del2, rightTaps[3], 1, wetRight, n);   // 2673
+    mixTap(rightTank.del1, rightTaps[4], -1, wetRight, n); // 2111
+    mixTap(rightTank.apf2, rightTaps[5], -1, wetRight, n); //  335
+    mixTap(rightTank.del2, rightTaps[6], -1, wetRight, n); //  121
 
     // Mix
-    *leftOut = dryLeft * dry + wetLeft * wet;
-    *rightOut = dryRight * dry + wetRight * wet;
+    for (I i = 0; i < n; ++i) {
+      left[i] = left[i] * dry + wetLeft[i] * wet;
+      right[i] = right[i] * dry + wetRight[i] * wet;
+    }
   }
 
 private:
@@ -521,58 +774,82 @@ private:
 
   class DelayLine {
   public:
-    explicit DelayLine(I size_) : size(size_) {
-      // For speed, create a bigger buffer than we really need.
-      I bufferSize = ceilPowerOfTwo(size);
-      buffer.reset(new F[bufferSize]);
-      std::memset(&buffer[0], 0, bufferSize * sizeof(F));
+    DelayLine() = default;
+    ~DelayLine() = default;
 
-      mask = bufferSize - 1;
+    // The ring holds the longest delay plus a whole block, so a block can be
+    // pushed before it is read back. Nothing is allocated until allocate().
+    void setSize(I size_) {
+      size = size_;
+      length = size + kBlockSize + 2;
+    }
 
+    // Takes the line's piece of the reverb's arena, zeroed.
+    void allocate(ScratchArena &arena) {
+      buffer = arena.take(length);
       writeIdx = 0;
     }
 
-    ~DelayLine() = default;
-
-    inline void push(F val) {
-      buffer[writeIdx++] = val;
-      writeIdx &= mask;
+    inline void push(const F *vals, I n) {
+      const I first = std::min(n, length - writeIdx);
+      std::copy_n(vals, first, buffer + writeIdx);
+      std::copy_n(vals + first, n - first, buffer);
+      writeIdx += n;
+      if (writeIdx >= length)
+        writeIdx -= length;
     }
 
-    inline F tap(F delay /* samples */) {
+    // What a single tap(delay) gives once `ahead` more samples have been
+    // pushed; that can't be more than the delay.
+    inline F tap(F delay, I ahead) const {
       // We always want to be able to properly handle any delay value that
       // gets passed in here, without going past the original size.
       jassert(delay <= size);
 
       I d = static_cast<uint32_t>(delay);
       F frac = 1 - (delay - d);
+      jassert(ahead <= d);
 
-      I readIdx = (writeIdx - 1) - d;
-      F a = buffer[(readIdx - 1) & mask];
-      F b = buffer[readIdx & mask];
+      I readIdx = behind(d + 2 - ahead);
+      F a = buffer[readIdx];
+      F b = buffer[readIdx + 1 == length ? 0 : readIdx + 1];
 
       return a + (b - a) * frac;
     }
 
-    // This does read-before-write.
-    inline F tapAndPush(F delay, F val) {
-      F out = tap(delay);
-      push(val);
-      return out;
+    // The same for n samples in a row, the first of them as the line stood
+    // `back` pushes ago. The run is read in at most two pieces, front to
+    // back, so the cursors only ever move forward through memory.
+    inline void tap(F delay, F *out, I n, I back) const {
+      jassert(delay <= size);
+
+      I d = static_cast<uint32_t>(delay);
+      F frac = 1 - (delay - d);
+
+      F run[kBlockSize + 1];
+      const I start = behind(back + d + 2);
+      const I first = std::min(n + 1, length - start);
+      std::copy_n(buffer + start, first, run);
+      std::copy_n(buffer, n + 1 - first, run + first);
+
+      for (I i = 0; i < n; ++i)
+        out[i] = run[i] + (run[i + 1] - run[i]) * frac;
     }
 
-    inline I getSize() { return size; }
+    inline I getSize() const { return size; }
+    inline I getLength() const { return length; }
 
   private:
-    const I size;
-
-    std::unique_ptr<F[]> buffer;
-    I mask;
+    I size = 0;
+    I length = 0;
 
-    I writeIdx;
+    F *buffer = nullptr;
+    I writeIdx = 0;
 
-    static I ceilPowerOfTwo(I n) {
-      return (I)std::pow(2, std::ceil(std::log(n) / std::log(2)));
+    // Where the sample k before the next write sits, for 0 < k <= length.
+    inline I behind(I k) const {
+      const I idx = writeIdx + length - k;
+      return idx >= length ? idx - length : idx;
     }
   };
 
@@ -582,27 +859,64 @@ private:
 
   class DelayAllpass {
   public:
-    DelayAllpass(I size_, F gain_) : delayLine(size_), gain(gain_) {}
-
+    DelayAllpass() = default;
     ~DelayAllpass() = default;
 
-    inline F process(F x, F delay) {
-      F wd = delayLine.tap(delay);
-      F w = x + gain * wd;
-      F y = -gain * w + wd;
-      delayLine.push(w);
-      return y;
+    void setSize(I size_, F gain_) {
+      delayLine.setSize(size_);
+      gain = gain_;
+    }
+
+    // In place, with a fixed delay. The delay line is read a run at a time,
+    // each run no longer than the delay, so it never needs what the same
+    // run writes.
+    inline void process(F *x, F delay, I n) {
+      const I span = static_cast<uint32_t>(delay) + 1;
+      for (I done = 0; done < n;) {
+        const I m = std::min(n - done, span);
+        F *xs = x + done;
+
+        F wd[kBlockSize], w[kBlockSize];
+        delayLine.tap(delay, wd, m, 0);
+        for (I i = 0; i < m; ++i) {
+          w[i] = xs[i] + gain * wd[i];
+          xs[i] = -gain * w[i] + wd[i];
+        }
+        delayLine.push(w, m);
+        done += m;
+      }
+    }
+
+    // In place, with the delay changing every sample; anything the next
+    // tap needs is pushed first.
+    inline void process(F *x, const F *delays, I n) {
+      F w[kBlockSize];
+      I written = 0;
+      for (I i = 0; i < n; ++i) {
+        if (i - written > static_cast<uint32_t>(delays[i])) {
+          delayLine.push(w + written, i - written);
+          written = i;
+        }
+        F wd = delayLine.tap(delays[i], i - written);
+        w[i] = x[i] + gain * wd;
+        x[i] = -gain * w[i] + wd;
+      }
+      delayLine.push(w + written, n - written);
     }
 
     inline void setGain(F gain_) { gain = gain_; }
 
-    inline F tap(F delay) { return delayLine.tap(delay); }
+    inline void tap(F delay, F *out, I n, I back) const {
+      delayLine.tap(delay, out, n, back);
+    }
+
+    inline I getSize() const { return delayLine.getSize(); }
 
-    inline I getSize() { return delayLine.getSize(); }
+    inline DelayLine &getLine() { return delayLine; }
 
   private:
     DelayLine delayLine;
-    F gain;
+    F gain = 0;
   };
 
   //--------------------------------------------------------------
@@ -668,11 +982,11 @@ private:
       apf1Size = apf1Size_;
       maxModDepth = maxModDepth_;
       F maxApf1Size = apf1Size + maxModDepth + 1;
-      apf1.reset(new DelayAllpass((uint32_t)maxApf1Size, apf1Gain_));
+      apf1.setSize((uint32_t)maxApf1Size, apf1Gain_);
 
-      del1.reset(new DelayLine(delay1Size_));
-      apf2.reset(new DelayAllpass(apf2Size_, apf2Gain_));
-      del2.reset(new DelayLine(delay2Size_));
+      del1.setSize(delay1Size_);
+      apf2.setSize(apf2Size_, apf2Gain_);
+      del2.setSize(delay2Size_);
 
       // We've changed the various delay line sizes and associated values,
       // so update the sizeRatio values too.
@@ -681,7 +995,7 @@ private:
 
     void setDecay(F decayRate_) {
       decayRate = decayRate_;
-      apf2->setGain(clamp(decayRate + 0.15f, 0.25f, 0.5f));
+      apf2.setGain(clamp(decayRate + 0.15f, 0.25f, 0.5f));
     }
 
     void setSizeRatio(F sizeRatio_) {
@@ -689,27 +1003,42 @@ private:
       recalcSizeRatio();
     }
 
-    void process(F val) {
+    // The longest block whose outputs del2 holds before the block runs.
+    inline I getMaxBlockSize() const {
+      return static_cast<uint32_t>(del2Delay) + 1;
+    }
+
+    // The tank's output for each sample of the next block.
+    inline void readOutputs(F *y, I n) const {
+      jassert(n <= getMaxBlockSize());
+      del2.tap(del2Delay, y, n, 0);
+    }
+
+    // A block through the tank runs in two halves, either side of the
+    // damping filter, which PlateReverb runs for both tanks at once.
+    void processInput(F *x, I n) {
       // APF1: "Controls density of tail."
-      val = apf1->process(val, apf1Delay + lfo.process() * modDepth);
-      val = del1->tapAndPush(del1Delay, val);
+      F delays[kBlockSize];
+      for (I i = 0; i < n; ++i)
+        delays[i] = apf1Delay + lfo.process() * modDepth;
+      apf1.process(x, delays, n);
 
-      val = damping.process(val);
-      val *= decayRate;
+      del1.push(x, n);
+      del1.tap(del1Delay, x, n, n);
+    }
 
+    void processOutput(F *x, I n) {
       // APF2: "Decorrelates tank signals."
-      val = apf2->process(val, apf2Delay);
-      val = del2->tapAndPush(del2Delay, val);
-
-      out = val;
+      apf2.process(x, apf2Delay, n);
+      del2.push(x, n);
     }
 
     F out = 0.0;
 
-    std::unique_ptr<DelayAllpass> apf1 = nullptr;
-    std::unique_ptr<DelayAllpass> apf2 = nullptr;
-    std::unique_ptr<DelayLine> del1 = nullptr;
-    std::unique_ptr<DelayLine> del2 = nullptr;
+    DelayAllpass apf1;
+    DelayAllpass apf2;
+    DelayLine del1;
+    DelayLine del2;
     OnePoleFilter damping;
     Lfo lfo;
 
@@ -730,12 +1059,35 @@ private:
       apf1Delay = apf1Size * sizeRatio;
       modDepth = maxModDepth * sizeRatio;
 
-      apf2Delay = apf2->getSize() * sizeRatio;
-      del1Delay = del1->getSize() * sizeRatio;
-      del2Delay = del2->getSize() * sizeRatio;
+      apf2Delay = apf2.getSize() * sizeRatio;
+      del1Delay = del1.getSize() * sizeRatio;
+      del2Delay = del2.getSize() * sizeRatio;
     }
   };
 
+  // Visits every delay line in the order the signal goes through them.
+  template <class Fn> void forEachLine(Fn &&fn) {
+    fn(predelayLine);
+    for (auto &diffuser : diffusers)
+      fn(diffuser.getLine());
+    for (auto *tank : {&leftTank, &rightTank}) {
+      fn(tank->apf1.getLine());
+      fn(tank->del1);
+      fn(tank->apf2.getLine());
+      fn(tank->del2);
+    }
+  }
+
+  // Adds sign * line.tap(delay), as it stood just after each sample of the
+  // last block was written, to wet.
+  template <class Line>
+  static inline void mixTap(const Line &line, F delay, F sign, F *wet, I n) {
+    F t[kBlockSize];
+    line.tap(delay, t, n, n - 1);
+    for (I i = 0; i < n; ++i)
+      wet[i] += sign * t[i];
+  }
+
   //--------------------------------------------------------------
   //--------------------------------------------------------------
   //--------------------------------------------------------------
@@ -747,10 +1099,12 @@ private:
   F predelay = 0.0;
   F decayRate = 0.0;
 
-  std::unique_ptr<DelayLine> predelayLine = nullptr;
+  static const I kNumLines = 13;
+  ScratchArena lineArena;
+
+  DelayLine predelayLine;
   OnePoleFilter lowpass;
-  std::array<std::unique_ptr<DelayAllpass>, 4> diffusers = {nullptr, nullptr,
-                                                            nullptr, nullptr};
+  std::array<DelayAllpass, 4> diffusers;
 
   Tank leftTank;
   Tank rightTank;
@@ -876,16 +1230,26 @@ public:
 
   ~WaveShaperProcessor() = default;
 
-  void prepare(juce::dsp::ProcessSpec spec) {
+  // oversampleFactor is 2, or 4 for offline renders
+  void prepare(juce::dsp::ProcessSpec spec, int oversampleFactor = 2) {
     sampleRate = spec.sampleRate;
+    factor = oversampleFactor == 4 ? 4 : 2;
     auto upsampledSpec = spec;
-    upsampledRate = sampleRate * 2.0;
+    upsampledRate = sampleRate * factor;
     upsampledSpec.sampleRate = upsampledRate;
 
     usL.set_coefs(coefs1);
     usR.set_coefs(coefs1);
     dsL.set_coefs(coefs1);
     dsR.set_coefs(coefs1);
+    usL2.set_coefs(coefs1);
+    usR2.set_coefs(coefs1);
+    dsL2.set_coefs(coefs1);
+    dsR2.set_coefs(coefs1);
+    for (auto *u : {&usL, &usR, &usL2, &usR2})
+      u->clear_buffers();
+    for (auto *d : {&dsL, &dsR, &dsL2, &dsR2})
+      d->clear_buffers();
 
     drive.reset(upsampledRate, 0.02f);
     preGain.prepare(upsampledSpec);
@@ -916,21 +1280,41 @@ public:
     fullwaveprocs[1].get()->prepare(upsampledRate, spec.maximumBlockSize);
   }
 
+  // any length: runs through the block maxChunk samples at a time, so the
+  // oversampled scratch stays small
   void process(const juce::dsp::ProcessContextReplacing<float> &context) {
+    const auto &block = context.getOutputBlock();
+    const auto numSamples = block.getNumSamples();
+    for (size_t pos = 0; pos < numSamples; pos += maxChunk) {
+      auto chunk = block.getSubBlock(
+          pos, std::min(static_cast<size_t>(maxChunk), numSamples - pos));
+      processChunk(juce::dsp::ProcessContextReplacing<float>(chunk));
+    }
+  }
+
+  void processChunk(const juce::dsp::ProcessContextReplacing<float> &context) {
     const int numSamples =
         static_cast<int>(context.getOutputBlock().getNumSamples());
-    const auto numSamples2 = numSamples * 2;
+    jassert(numSamples <= maxChunk);
+    const auto numSamples2 = numSamples * factor;
 
     auto *dataL = context.getOutputBlock().getChannelPointer(0);
     auto *dataR = context.getOutputBlock().getChannelPointer(1);
-    usL.process_block(us1L, dataL, numSamples);
-    usR.process_block(us1R, dataR, numSamples);
+    if (factor == 4) {
+      usL.process_block(midL, dataL, numSamples);
+      usR.process_block(midR, dataR, numSamples);
+      usL2.process_block(us1L, midL, numSamples * 2);
+      usR2.process_block(us1R, midR, numSamples * 2);
+    } else {
+      usL.process_block(us1L, dataL, numSamples);
+      usR.process_block(us1R, dataR, numSamples);
+    }
     float *channels[2]{us1L, us1R};
     auto upblock = juce::dsp::AudioBlock<float>(
         channels, static_cast<size_t>(2), static_cast<size_t>(numSamples2));
     const auto upcontext = juce::dsp::ProcessContextReplacing<float>(upblock);
 
-    for (int i = 0; i < MINI_BLOCK_SIZE * 2; ++i) {
+    for (int i = 0; i < numSamples2; ++i) {
       us2L[i] = us1L[i]; // copy for dry signal
       us2R[i] = us1R[i];
     }
@@ -950,8 +1334,15 @@ public:
       us1R[i] = us1R[i] * wet + us2R[i] * dry;
     }
 
-    dsL.process_block(dataL, us1L, numSamples);
-    dsR.process_block(dataR, us1R, numSamples);
+    if (factor == 4) {
+      dsL2.process_block(midL, us1L, numSamples * 2);
+      dsR2.process_block(midR, us1R, numSamples * 2);
+      dsL.process_block(dataL, midL, numSamples);
+      dsR.process_block(dataR, midR, numSamples);
+    } else {
+      dsL.process_block(dataL, us1L, numSamples);
+      dsR.process_block(dataR, us1R, numSamples);
+    }
 
     highPassPost.process(context);
     postGain.process(context);
@@ -1051,10 +1442,14 @@ public:
 
 private:
   juce::AudioBuffer<float> inBuffer;
-  float us1L[MINI_BLOCK_SIZE * 2]{0.f}; // upsampled buffer to be processed
-  float us1R[MINI_BLOCK_SIZE * 2]{0.f};
-  float us2L[MINI_BLOCK_SIZE * 2]{0.f}; // copy to be mixed wet/dry
-  float us2R[MINI_BLOCK_SIZE * 2]{0.f};
+  static constexpr int maxFactor = 4;
+  static constexpr int maxChunk = 32;
+  float us1L[maxChunk * maxFactor]{0.f}; // upsampled buffer to be processed
+  float us1R[maxChunk * maxFactor]{0.f};
+  float us2L[maxChunk * maxFactor]{0.f}; // copy to be mixed wet/dry
+  float us2R[maxChunk * maxFactor]{0.f};
+  float midL[maxChunk * 2]{0.f}; // between the two stages at 4x
+  float midR[maxChunk * 2]{0.f};
 
   using Filter = juce::dsp::IIR::Filter<float>;
   using Coefficients = juce::dsp::IIR::Coefficients<float>;
@@ -1067,6 +1462,7 @@ private:
 
   double sampleRate{44100.0};
   double upsampledRate{88200.0};
+  int factor{2};
   int currentFunction = 0; // to trigger a change on first setFunctionToUse call
   float dry{0.5f}, wet{0.5f};
 
@@ -1077,13 +1473,13 @@ private:
                             0.86299283427175177,  0.9547836337311687};
 
 #if USE_NEON
-  hiir::Downsampler2xNeon<nbr_coefs1> dsL, dsR;
-  hiir::Upsampler2xNeon<nbr_coefs1> usL, usR;
+  hiir::Downsampler2xNeon<nbr_coefs1> dsL, dsR, dsL2, dsR2;
+  hiir::Upsampler2xNeon<nbr_coefs1> usL, usR, usL2, usR2;
 #endif
 
 #if USE_SSE
-  hiir::Upsampler2xSse<nbr_coefs1> usL, usR;
-  hiir::Downsampler2xSse<nbr_coefs1> dsL, dsR;
+  hiir::Upsampler2xSse<nbr_coefs1> usL, usR, usL2, usR2;
+  hiir::Downsampler2xSse<nbr_coefs1> dsL, dsR, dsL2, dsR2;
 #endif
 };
 
@@ -1099,8 +1495,11 @@ public:
 
   inline void setParams(const RingModParams &params_) { params = params_; }
 
-  void prepare(juce::dsp::ProcessSpec spec) {
+  // oversampleFactor is 2, or 4 for offline renders
+  void prepare(juce::dsp::ProcessSpec spec, int oversampleFactor = 2) {
     sampleRate = spec.sampleRate;
+    oversampleOrder = oversampleFactor == 4 ? 2 : 1;
+    oversampleRatio = 1 << oversampleOrder;
     oversampledSampleRate = sampleRate * oversampleRatio;
     const juce::dsp::ProcessSpec oversampledSpec{
         oversampledSampleRate,
@@ -42,7 +42,10 @@ SOFTWARE.
 
 #define _USE_MATH_DEFINES
 #include <juce_dsp/juce_dsp.h>
+#include <algorithm>
+#include <bit>
 #include <cmath>
+#include <cstdint>
 #include <numbers>
 
 using std::numbers::pi;
@@ -96,6 +99,29 @@ public:
 		return x1;
 	}
 
+	// 2^x for |x| < 126. Rounding x leaves a fraction in [-0.5, 0.5], where a
+	// sixth-order series is good to under a part per million (about a
+	// thousandth of a cent); the whole part goes straight into the exponent.
+	static inline float fastExp2(float x)
+	{
+		x = std::clamp(x, -126.f, 126.f);
+		const float whole = std::floor(x + 0.5f);
+		const float f = x - whole;
+		const float p = 1.f + f * (0.693147181f
+			+ f * (0.240226507f
+			+ f * (0.0555041087f
+			+ f * (0.00961812911f
+			+ f * (0.00133335581f
+			+ f * 0.000154035304f)))));
+		return p * std::bit_cast<float>((static_cast<int32_t>(whole) + 127) << 23);
+	}
+
+	// gin::getMidiNoteInHertz without the pow()
+	static inline float noteToHz(const float note)
+	{
+		return 440.f * fastExp2((note - 69.f) * (1.f / 12.f));
+	}
+
 	using SIMD = juce::dsp::SIMDRegister<float>;
 
 	static inline juce::dsp::SIMDRegister<float> simdSin(juce::dsp::SIMDRegister<float> x1)
@@ -15,7 +15,9 @@
 #pragma once
 
 #define _USE_MATH_DEFINES
+#include "FastMath.hpp"
 #include <juce_core/juce_core.h>
+#include <juce_dsp/juce_dsp.h>
 #include <cmath>
 #include <numbers>
 
@@ -28,18 +30,7 @@ public:
 		float sampleRate{44100.f};
 	};
 
-	struct LFOValuesByPhase {
-		float deg0Value{0.f};
-		float deg120Value{0.f};
-		float deg240Value{0.f};
-	};
-
-	LFO() {
-		for (int i = 0; i < 1024; ++i) {
-			sineTable[i] = std::sin(i * (2.0 * pi / 1024));
-		}
-	}
-
+	LFO() = default;
 	~LFO() = default;
 
 	// params
@@ -54,30 +45,30 @@ public:
 		phaseIncrement = frequency / sampleRate;
 	}
 
-	static inline double lerp(double a, double b, double t)
+	// The next n samples of the sine at 0, 120 and 240 degrees, in lanes 0-2
+	// of each register; lane 3 is zero. The phase is kept in double and
+	// only the three offsets and the sines go through the lanes.
+	void getNextBlock(juce::dsp::SIMDRegister<float> *out, const int n)
 	{
-		return a + (b - a) * t;
-	}
-
-	LFOValuesByPhase getNextValues()
-	{
-		phase += phaseIncrement;
-		phase = phase - std::floor(phase);
-		auto phase120 = phase + 1.0 / 3.0;
-		phase120 = phase120 - std::floor(phase120);
-		auto phase240 = phase + 2.0 / 3.0;
-		phase240 = phase240 - std::floor(phase240);
+		using SIMD = juce::dsp::SIMDRegister<float>;
+		alignas(16) static constexpr float offsets[4]{0.f, 1.f / 3.f, 2.f / 3.f, 0.f};
+		alignas(16) static constexpr float signs[4]{-1.f, -1.f, -1.f, 0.f};
+		const SIMD offset = SIMD::fromRawArray(offsets), sign = SIMD::fromRawArray(signs);
+		const SIMD one{1.f}, half{.5f}, twoPi{2.f * juce::MathConstants<float>::pi};
 
-		const auto index1 = static_cast<int>(phase * 1024);
-		const auto index2 = static_cast<int>(phase120 * 1024);
-		const auto index3 = static_cast<int>(phase240 * 1024);
-		const double frac1 = phase * 1024 - index1;
-		const double frac2 = phase120 * 1024 - index2;
-		const double frac3 = phase240 * 1024 - index3;
-		values.deg0Value =   static_cast<float>(lerp(sineTable[std::clamp(index1, 0, 1023)], sineTable[std::clamp(index1+1, 0, 1023)], frac1));
-		values.deg120Value = static_cast<float>(lerp(sineTable[std::clamp(index2, 0, 1023)], sineTable[std::clamp(index2+1, 0, 1023)], frac2));
-		values.deg240Value = static_cast<float>(lerp(sineTable[std::clamp(index3, 0, 1023)], sineTable[std::clamp(index3+1, 0, 1023)], frac3));
-		return values;
+		for (int i = 0; i < n; ++i) {
+			phase += phaseIncrement;
+			phase -= std::floor(phase);
+			auto p = SIMD(static_cast<float>(phase)) + offset;
+			p = p - (one & SIMD::greaterThanOrEqual(p, one));
+			// sin(2 pi p) = -sin(2 pi q) for q = p - 1/2, and q folds about
+			// +-1/4 into the quarter turns either side of zero, where simdSin
+			// is good to a few parts in 10^7
+			auto q = p - half;
+			q = SIMD::min(q, half - q);
+			q = SIMD::max(q, SIMD(-.5f) - q);
+			out[i] = FastMath<float>::simdSin(q * twoPi) * sign;
+		}
 	}
 
 	inline void initialize()
@@ -87,9 +78,7 @@ public:
 	}
 
 private:
-	LFOValuesByPhase values;
 	double frequency{1.0}, sampleRate{44100.0};
-	double sineTable[1024];
 	double phaseIncrement{0.0};
 	double phase{0.0};
 };
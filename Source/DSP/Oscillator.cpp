@@ -1,8 +1,10 @@
 #include "Oscillator.h"
 
 #include "SynthVoice3.h"
+#include <numbers>
 
-APOscillator::APOscillator(gin::BandLimitedLookupTables &bllt_) : bllt(bllt_)
+APOscillator::APOscillator(gin::BandLimitedLookupTables &bllt_, const APWavetables &tables_)
+    : bllt(bllt_), tables(tables_)
 {
 	setSampleRate(sampleRate);  // bllt.setSampleRate(sampleRate);
 }
@@ -14,10 +16,93 @@ void APOscillator::renderFloats(float freq,
     const int numSamples)
 {
 	const float delta = freq * invSampleRate;
+
+	if (settings.analytic) {
+		renderPhasor(delta, settings.vol, xs, ys, numSamples);
+		return;
+	}
+
+	if (!APWavetables::hasTable(settings.wave)) {
+		for (int i = 0; i < numSamples; i++) {
+			xs[i] = bllt.process(settings.wave, freq, phase) * settings.vol;
+			ys[i] = bllt.process(settings.wave, freq, qrtPhase(phase)) * settings.vol;
+			phase += delta;
+			phase -= std::trunc(phase);
+		}
+		return;
+	}
+	jassert(numSamples <= maxBlockSamples);
+
+	// Phase as 32-bit fixed point, so it wraps by itself: the top bits index
+	// the table, the rest is the interpolation fraction
+	constexpr int lanes = mipp::N<int32_t>();
+	constexpr int fracBits = 32 - APWavetables::tableOrder;
+	constexpr float fracScale = 1.0f / static_cast<float>(1 << fracBits);
+	const auto start = static_cast<uint32_t>(static_cast<double>(phase) * 4294967296.0);
+	const auto step = static_cast<uint32_t>(static_cast<double>(delta) * 4294967296.0);
+
+	alignas(64) int32_t first[lanes];
+	for (int l = 0; l < lanes; l++)
+		first[l] = static_cast<int32_t>(start + step * static_cast<uint32_t>(l));
+
+	mipp::Reg<int32_t> acc(first);
+	const mipp::Reg<int32_t> advance(static_cast<int32_t>(step * static_cast<uint32_t>(lanes)));
+	const mipp::Reg<int32_t> indexMask(APWavetables::tableMask);
+	const mipp::Reg<int32_t> fracMask((1 << fracBits) - 1);
+	for (int i = 0; i < numSamples; i += lanes) {
+		const mipp::Reg<int32_t> index = (acc >> fracBits) & indexMask;  // shift is arithmetic, so mask
+		const mipp::Reg<float> fraction = mipp::cvt<int32_t, float>(acc & fracMask) * fracScale;
+		index.store(&indices[i]);
+		fraction.store(&fractions[i]);
+		acc += advance;
+	}
+
+	// the same key the band-limited lookup has always been given (the
+	// frequency, banded as if it were a note), so patches keep their brightness
+	const float *row = tables.getRow(settings.wave, freq);
+	const float vol = settings.vol;
 	for (int i = 0; i < numSamples; i++) {
-		xs[i] = bllt.process(settings.wave, freq, phase) * settings.vol;
-		ys[i] = bllt.process(settings.wave, freq, qrtPhase(phase)) * settings.vol;
-		phase += delta;
-		phase -= std::trunc(phase);
+		const int x0 = indices[i];
+		const int y0 = (x0 + APWavetables::quarter) & APWavetables::tableMask;
+		const float f = fractions[i];
+		xs[i] = (row[x0] + f * (row[x0 + 1] - row[x0])) * vol;
+		ys[i] = (row[y0] + f * (row[y0 + 1] - row[y0])) * vol;
 	}
+
+	const auto end = start + step * static_cast<uint32_t>(numSamples);
+	phase = static_cast<float>(static_cast<double>(end) / 4294967296.0);
+	phase -= std::trunc(phase);  // rounding can land on 1.0f
+}
+
+// A sine needs no band-limiting, so (cos, sin) comes from rotating a unit
+// phasor: each lane starts one sample apart and steps `lanes` samples per
+// complex multiply. It's reseeded from `phase` every block, which keeps the
+// drift down and lets bumpPhase land exactly where it always did.
+void APOscillator::renderPhasor(const float delta, const float vol, float *xs, float *ys, const int numSamples)
+{
+	constexpr int lanes = mipp::N<float>();
+	constexpr double twoPi = 2.0 * std::numbers::pi;
+
+	alignas(64) float re[lanes], im[lanes];
+	for (int l = 0; l < lanes; l++) {
+		const double angle = twoPi * (static_cast<double>(phase) + static_cast<double>(delta) * l);
+		re[l] = static_cast<float>(std::cos(angle)) * vol;
+		im[l] = static_cast<float>(std::sin(angle)) * vol;
+	}
+	const double stepAngle = twoPi * static_cast<double>(delta) * lanes;
+	const mipp::Reg<float> stepRe(static_cast<float>(std::cos(stepAngle)));
+	const mipp::Reg<float> stepIm(static_cast<float>(std::sin(stepAngle)));
+
+	mipp::Reg<float> zRe(re), zIm(im);
+	for (int i = 0; i < numSamples; i += lanes) {
+		zIm.store(&xs[i]);  // x is the sine,
+		zRe.store(&ys[i]);  // y a quarter turn on
+		const auto nextRe = mipp::fnmadd(zIm, stepIm, zRe * stepRe);
+		zIm = mipp::fmadd(zRe, stepIm, zIm * stepRe);
+		zRe = nextRe;
+	}
+
+	const double next = static_cast<double>(phase) + static_cast<double>(delta) * numSamples;
+	phase = static_cast<float>(next - std::floor(next));
+	phase -= std::trunc(phase);  // rounding can land on 1.0f
 }
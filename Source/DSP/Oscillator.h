@@ -2,12 +2,13 @@
 #include <gin_dsp/gin_dsp.h>
 #include <gin_plugin/gin_plugin.h>
 #include <cmath>
+#include "Wavetables.h"
 
 struct Position;
 class APOscillator  // : public gin::StereoOscillator
 {
 public:
-	APOscillator(gin::BandLimitedLookupTables &bllt_);
+	APOscillator(gin::BandLimitedLookupTables &bllt_, const APWavetables &tables_);
 	~APOscillator() = default;
 
 	[[nodiscard]] static inline float qrtPhase(const float phase_)
@@ -40,9 +41,17 @@ public:
 		phase -= std::trunc(phase);
 	}
 
+	// move on as if we'd rendered numSamples, without rendering them
+	inline void advance(const float freq, const int numSamples)
+	{
+		phase += freq * invSampleRate * static_cast<float>(numSamples);
+		phase -= std::trunc(phase);
+	}
+
 	struct Settings {
 		gin::Wave wave = gin::Wave::sine;
 		float vol = 0.0f;
+		bool analytic = false;  // pure sine by phasor rotation, no table
 	};
 
 	void renderFloats(float note,
@@ -51,8 +60,18 @@ public:
 	    float *ys,
 	    const int numSamples);
 
-	gin::BandLimitedLookupTables &bllt;
+	static constexpr int maxBlockSamples = 128;
+
+	gin::BandLimitedLookupTables &bllt;  // still used for the noises
+	const APWavetables &tables;
 	float sampleRate = 44100.0f;
 	float invSampleRate = 1.0f / sampleRate;
 	float phase = 0.0f;
+
+private:
+	void renderPhasor(float delta, float vol, float *xs, float *ys, int numSamples);
+
+	// table positions for a block, worked out together in SIMD
+	alignas(64) int32_t indices[maxBlockSamples]{};
+	alignas(64) float fractions[maxBlockSamples]{};
 };
@@ -0,0 +1,68 @@
+/*
+ * Audible Planets - an expressive, quasi-Ptolemaic semi-modular synthesizer
+ *
+ * Copyright 2024, Greg Recco
+ *
+ * Audible Planets is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * All source for Audible Planets is available at
+ * https://github.com/gregrecco67/AudiblePlanets
+ */
+
+#include "ParamSnapshot.h"
+
+ParamSnapshot::ParamSnapshot(gin::ModMatrix &m) : modMatrix(m) {}
+
+ParamSnapshot::~ParamSnapshot()
+{
+	modMatrix.removeListener(this);
+}
+
+void ParamSnapshot::setup(const juce::Array<gin::Parameter *> &polyParams, const juce::Array<gin::ModSrcId> &polySources)
+{
+	params = polyParams;
+
+	int maxIndex = -1;
+	for (const auto *p : params)
+		maxIndex = std::max(maxIndex, p->getModIndex());
+	values.assign(static_cast<size_t>(maxIndex + 1), 0.f);
+	polyModulated = std::vector<std::atomic<bool>>(static_cast<size_t>(maxIndex + 1));
+
+	int maxSource = -1;
+	for (const auto &src : polySources)
+		maxSource = std::max(maxSource, src.id);
+	polySource.assign(static_cast<size_t>(maxSource + 1), false);
+	for (const auto &src : polySources)
+		polySource[static_cast<size_t>(src.id)] = true;
+
+	refresh();
+	modMatrix.addListener(this);
+}
+
+void ParamSnapshot::update()
+{
+	for (auto *p : params)
+		values[static_cast<size_t>(p->getModIndex())] = modMatrix.getValue(p);
+}
+
+void ParamSnapshot::refresh()
+{
+	int count = 0;
+	for (auto *p : params) {
+		bool poly = false;
+		if (modMatrix.isModulated(gin::ModDstId(p->getModIndex()))) {
+			for (const auto &src : modMatrix.getModSources(p)) {
+				if (src.id >= 0 && src.id < static_cast<int>(polySource.size()) && polySource[static_cast<size_t>(src.id)]) {
+					poly = true;
+					break;
+				}
+			}
+		}
+		polyModulated[static_cast<size_t>(p->getModIndex())].store(poly, std::memory_order_relaxed);
+		count += poly ? 1 : 0;
+	}
+	numPolyModulated.store(count, std::memory_order_relaxed);
+}
@@ -0,0 +1,65 @@
+/*
+ * Audible Planets - an expressive, quasi-Ptolemaic semi-modular synthesizer
+ *
+ * Copyright 2024, Greg Recco
+ *
+ * Audible Planets is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * All source for Audible Planets is available at
+ * https://github.com/gregrecco67/AudiblePlanets
+ */
+
+#pragma once
+
+#include <gin_plugin/gin_plugin.h>
+#include <atomic>
+#include <vector>
+
+//==============================================================================
+// Values of the poly parameters, read once per block on behalf of every
+// voice. A parameter with no poly mod source routed to it has the same value
+// in every voice, so voices take it from here and only go through the mod
+// matrix for the few parameters that actually have poly modulation.
+class ParamSnapshot : private gin::ModMatrix::Listener {
+public:
+	explicit ParamSnapshot(gin::ModMatrix &m);
+	~ParamSnapshot() override;
+
+	// call once the matrix is built, with the poly parameters and sources
+	void setup(const juce::Array<gin::Parameter *> &polyParams, const juce::Array<gin::ModSrcId> &polySources);
+
+	// audio thread, once per block
+	void update();
+
+	// which parameters have a poly source on them; off the audio thread
+	void refresh();
+
+	[[nodiscard]] inline float get(const gin::Parameter *p) const
+	{
+		jassert(p->getModIndex() >= 0 && p->getModIndex() < static_cast<int>(values.size()));
+		return values[static_cast<size_t>(p->getModIndex())];
+	}
+
+	[[nodiscard]] inline bool isPolyModulated(const gin::Parameter *p) const
+	{
+		jassert(p->getModIndex() >= 0 && p->getModIndex() < static_cast<int>(values.size()));
+		return polyModulated[static_cast<size_t>(p->getModIndex())].load(std::memory_order_relaxed);
+	}
+
+	[[nodiscard]] int getNumPolyModulated() const { return numPolyModulated.load(std::memory_order_relaxed); }
+
+private:
+	void modMatrixChanged() override { refresh(); }
+
+	gin::ModMatrix &modMatrix;
+	juce::Array<gin::Parameter *> params;
+	std::vector<bool> polySource;       // by ModSrcId
+	std::vector<float> values;          // by mod index
+	std::vector<std::atomic<bool>> polyModulated;  // by mod index
+	std::atomic<int> numPolyModulated{0};
+
+	JUCE_DECLARE_NON_COPYABLE(ParamSnapshot)
+};
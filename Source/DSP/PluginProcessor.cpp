@@ -14,6 +14,7 @@
 
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "AllocationTrap.h"
 
 static juce::String ladderTypeTextFunction(const gin::Parameter &, float v)
 {
@@ -270,6 +271,32 @@ static juce::String freqTextFunction(const gin::Parameter &, const float v)
 	return juce::String(static_cast<int>(gin::getMidiNoteInHertz(v)));
 }
 
+static juce::String filterModeTextFunction(const gin::Parameter &, const float v)
+{
+	switch (static_cast<int>(v))
+	{
+	case 0:
+		return "Per Voice";
+	case 1:
+		return "Shared";
+	case 2:
+		return "SIMD Bank";
+	default:
+		jassertfalse;
+		return {};
+	}
+}
+
+static juce::String oversamplingTextFunction(const gin::Parameter &, const float v)
+{
+	return juce::String(1 << juce::jlimit(0, 3, static_cast<int>(v))) + "x";
+}
+
+static juce::String controlBlockTextFunction(const gin::Parameter &, const float v)
+{
+	return juce::String(16 << juce::jlimit(0, 4, static_cast<int>(v)));
+}
+
 static juce::String glideModeTextFunction(const gin::Parameter &, const float v)
 {
 	switch (static_cast<int>(v))
@@ -450,6 +477,8 @@ void APAudioProcessor::FilterParams::setup(APAudioProcessor &p)
 							  {0.0, maxFreq, 0.0f, 1.0}, 95.0, 0.1f, freqTextFunction);
 	resonance = p.addExtParam(
 		id + "res", nm + " Res", "Res", "", {0.0, 100.0, 0.0f, 1.0}, 0.0, 0.0f);
+	mode = p.addIntParam(id + "mode", nm + " Mode", "Mode", "",
+						 {0.0, 2.0, 1.0f, 1.0}, 0.0, 0.0f, filterModeTextFunction);
 
 	keyTracking->conversionFunction = [](const float in)
 	{ return in / 100.0f; };
@@ -662,6 +691,20 @@ void APAudioProcessor::GlobalParams::setup(APAudioProcessor &p)
 						enableTextFunction);
 	pitchbendRange = p.addIntParam(
 		"pbrange", "PB Range", "", "", {0.0, 96.0, 1.0, 1.0}, 2.0, 0.0f);
+	polyphony = p.addIntParam("polyphony", "Polyphony", "Voices", "",
+		{1.0, static_cast<float>(maxVoices), 1.0, 1.0}, 8.0, 0.0f);
+	renderThreads = p.addIntParam("renderThreads", "Render Threads", "Threads", "",
+		{1.0, static_cast<float>(VoiceRenderPool::maxThreads), 1.0, 1.0}, 1.0, 0.0f);
+	silenceThreshold = p.addIntParam("silenceThreshold", "Silence Threshold", "Silence", " dB",
+		{-120.0, -40.0, 0.0, 1.0}, -90.0, 0.0f);
+	silenceHold = p.addIntParam("silenceHold", "Silence Hold", "Hold", " ms",
+		{0.0, 1000.0, 0.0, 1.0}, 50.0, 0.0f);
+	oversampling = p.addIntParam("oversampling", "Oversampling", "Oversample", "",
+		{0.0, 3.0, 1.0, 1.0}, 2.0, 0.0f, oversamplingTextFunction);
+	controlBlock = p.addIntParam("controlBlock", "Control Block", "Ctl Block", " smp",
+		{0.0, 4.0, 1.0, 1.0}, 1.0, 0.0f, controlBlockTextFunction);
+	fxPipeline = p.addIntParam("fxPipeline", "FX Pipeline", "Pipeline", "",
+		{0.0, 1.0, 1.0, 1.0}, 0.0f, 0.0f, enableTextFunction);
 
 	level->conversionFunction = [](float in)
 	{
@@ -671,6 +714,8 @@ void APAudioProcessor::GlobalParams::setup(APAudioProcessor &p)
 	};
 	velSens->conversionFunction = [](float in)
 	{ return in / 100.0f; };
+	silenceThreshold->conversionFunction = [](float in)
+	{ return juce::Decibels::decibelsToGain(in); };
 }
 
 //==============================================================================
@@ -963,14 +1008,14 @@ APAudioProcessor::APAudioProcessor()
 	}
 	convex[0] = 0.0;
 	convex[1023] = 1.0;
+	envelopeShapes.build(convex);
 
 	hiir::PolyphaseIir2Designer::compute_coefs_spec_order_tbw(coefs1, nbr_coefs1, .28);
 	hiir::PolyphaseIir2Designer::compute_coefs_spec_order_tbw(coefs2, nbr_coefs2, .03);
 
-	dspl1L.set_coefs(coefs1); // 2x down with wide tb
-	dspl1R.set_coefs(coefs1); // 2x down with wide tb
-	dspl2L.set_coefs(coefs2); // 2x down with narrow tb
-	dspl2R.set_coefs(coefs2); // 2x down with narrow tb
+	dspl0.setCoefs(Stage0Coefs::_coef_list.data()); // 2x down from 8x
+	dspl12.setCoefs(coefs1, coefs2); // 2x down with wide tb, then with narrow tb
+	dspl2.setCoefs(coefs2); // 2x down with narrow tb
 
 	osc1Params.setup(*this, juce::String{"1"});
 	osc2Params.setup(*this, juce::String{"2"});
@@ -998,6 +1043,9 @@ APAudioProcessor::APAudioProcessor()
 
 	// mono params begin in the middle of this block
 	globalParams.setup(*this);
+	globalParams.oversampling->addListener(&reprepare);
+	globalParams.controlBlock->addListener(&reprepare);
+	globalParams.fxPipeline->addListener(&reprepare);
 
 	gainParams.setup(*this);
 	waveshaperParams.setup(*this);
@@ -1010,6 +1058,9 @@ APAudioProcessor::APAudioProcessor()
 	ladderParams.setup(*this);
 
 	fxOrderParams.setup(*this);
+	for (auto *param : fxOrderParams.routing())
+		param->addListener(&fxPlanRequest);
+	compileFXPlan();
 
 	mseg1Data.reset();
 	mseg2Data.reset();
@@ -1025,6 +1076,7 @@ APAudioProcessor::APAudioProcessor()
 	client = MTS_RegisterClient();
 	lf = std::make_unique<APLNF>();
 	setupModMatrix();
+	setupFXValues();
 	init();
 
 	modMatrix.setMonoValue(randSrc1Mono, 0.0f);
@@ -1033,6 +1085,14 @@ APAudioProcessor::APAudioProcessor()
 
 APAudioProcessor::~APAudioProcessor()
 {
+	fxPipeline.stop();
+	globalParams.oversampling->removeListener(&reprepare);
+	globalParams.controlBlock->removeListener(&reprepare);
+	globalParams.fxPipeline->removeListener(&reprepare);
+	reprepare.cancelPendingUpdate();
+	for (auto *param : fxOrderParams.routing())
+		param->removeListener(&fxPlanRequest);
+	fxPlanRequest.cancelPendingUpdate();
 	juce::LookAndFeel::setDefaultLookAndFeel(nullptr);
 	MTS_DeregisterClient(client);
 }
@@ -1085,22 +1145,34 @@ void APAudioProcessor::setupModMatrix()
 
 	const auto firstMonoParam = globalParams.mono;
 	bool polyParam = true;
+	juce::Array<gin::Parameter *> polyParams;
 	for (const auto pp : getPluginParameters())
 	{
 		if (pp == firstMonoParam)
 			polyParam = false;
 
 		if (!pp->isInternal())
+		{
 			modMatrix.addParameter(pp, polyParam);
+			if (polyParam)
+				polyParams.add(pp);
+		}
 	}
 
 	modMatrix.build();
+
+	paramSnapshot.setup(polyParams,
+		{modSrcLFO1, modSrcLFO2, modSrcLFO3, modSrcLFO4, modSrcPressure,
+		 modSrcTimbre, modPolyAT, modSrcNote, modSrcVelocity, modSrcVelOff,
+		 modSrcEnv1, modSrcEnv2, modSrcEnv3, modSrcEnv4, modSrcMSEG1,
+		 modSrcMSEG2, modSrcMSEG3, modSrcMSEG4, randSrc1Poly, randSrc2Poly});
 }
 
 void APAudioProcessor::stateUpdated() // called when loading a preset
 {
 	modMatrix.stateUpdated(state);
-	stereoDelay.resetBuffers();
+	paramSnapshot.refresh();
+	delayResetPending = true;  // the effects may be running on the FX pipeline
 
 	if (state.getOrCreateChildWithName("mseg1", nullptr).getNumChildren() > 0)
 	{
@@ -1158,6 +1230,10 @@ void APAudioProcessor::updateState() // called when saving a preset
 
 void APAudioProcessor::reset()
 {
+	// the worker has to be out of the effects while they're reset; its
+	// thread comes and goes with prepareToPlay and releaseResources
+	clearFXPipeline();
+
 	Processor::reset();
 
 	lfo1.reset();
@@ -1175,22 +1251,72 @@ void APAudioProcessor::prepareToPlay(
 	Processor::prepareToPlay(newSampleRate, newSamplesPerBlock);
 	const juce::dsp::ProcessSpec spec{newSampleRate, static_cast<juce::uint32>(newSamplesPerBlock), 2};
 
-	upsampledTables.setSampleRate(newSampleRate * 4);
+	fxPipeline.stop();  // before anything the effects use is touched
+	offline = isNonRealtime();
+	quality = offline ? offlineQuality : realtimeQuality;
+	pipelined = wantsFXPipeline();
+	oversampling = getOversamplingFactor();
+	controlBlock = getControlBlockSize();
+	// a voice never renders more than maxBlockSamples at a time, so a control
+	// block can take several voice chunks
+	voiceChunk = std::min(controlBlock, SynthVoice3::maxBlockSamples / oversampling);
+	const double voiceRate = newSampleRate * oversampling;
+	upsampledTables.setSampleRate(voiceRate);
+	orbitTables.build(upsampledTables, voiceRate);
 	analogTables.setSampleRate(newSampleRate);
 
-	synth.setCurrentPlaybackSampleRate(newSampleRate * 4);
+	synth.setCurrentPlaybackSampleRate(voiceRate);
+	synth.setVoiceControlPeriod(std::max(1, quality.voiceControlSamples / voiceChunk));
 	auxSynth.setCurrentPlaybackSampleRate(newSampleRate);
+
+	// all scratch audio, global and per voice, comes out of one arena
+	maxBlockSize = std::max(newSamplesPerBlock, 1);
+	const auto block = static_cast<size_t>(maxBlockSize);
+	const auto voiceBlock = block * static_cast<size_t>(oversampling);
+	pipelineLatency = pipelined ? maxBlockSize : 0;
+	const auto slotBlock = static_cast<size_t>(pipelineLatency);
+	scratch.reserve(2 * (2 * ScratchArena::footprint(block) + ScratchArena::footprint(voiceBlock))
+					+ FXPipeline::numSlots * 4 * ScratchArena::footprint(slotBlock)
+					+ synth.getScratchFloatsNeeded());
+	for (int ch = 0; ch < 2; ch++)
+	{
+		auxChannels[ch] = scratch.take(block);
+		laneBChannels[ch] = scratch.take(block);
+		preSynthChannels[ch] = scratch.take(voiceBlock);
+	}
+	// a frame per control block, and one more for each host block that
+	// starts partway through a slot. Every frame covers at least a sample,
+	// so a slot can't need more than pipelineLatency of them, however small
+	// the host's blocks get
+	maxFramesPerSlot = pipelined ? pipelineLatency : 0;
+	for (auto &slot : fxSlots)
+	{
+		for (int ch = 0; ch < 2; ch++)
+		{
+			slot.main[ch] = pipelined ? scratch.take(slotBlock) : nullptr;
+			slot.aux[ch] = pipelined ? scratch.take(slotBlock) : nullptr;
+		}
+		slot.frames.allocate(static_cast<size_t>(maxFramesPerSlot), true);
+	}
+	dspl0.clearBuffers();
+	dspl12.clearBuffers();
+	dspl2.clearBuffers();
+	synth.assignScratch(scratch);
+	chunkMidi.ensureSize(4096);
+	numVoices = 0;  // force it through
+	updatePolyphony();
+	synth.setNumRenderThreads(globalParams.renderThreads->getUserValueInt());
 	modMatrix.setSampleRate(newSampleRate);
 
-	stereoDelay.prepare(spec);
+	stereoDelay.prepare(spec, getLongestDelayTime());
 	effectGain.prepare(spec);
-	waveshaper.prepare(spec);
+	waveshaper.prepare(spec, quality.fxOversampling);
 	compressor.setSampleRate(newSampleRate);
 	compressor.setNumChannels(2);
 	chorus.prepare(spec);
 	reverb.prepare(spec);
 	mbfilter.prepare(spec);
-	ringmod.prepare(spec);
+	ringmod.prepare(spec, quality.fxOversampling);
 	ladder.prepare(spec);
 	limiter.prepare(spec);
 	limiter.setRelease(0.1f);
@@ -1201,6 +1327,9 @@ void APAudioProcessor::prepareToPlay(
 	lfo4.setSampleRate(newSampleRate);
 
 	laneAFilter.setSampleRate(newSampleRate);
+	sharedFilter.setNumChannels(2);
+	sharedFilter.setSampleRate(newSampleRate);
+	sharedFilter.reset();
 	laneBFilter.setSampleRate(newSampleRate);
 	laneAFilterCutoff.reset(newSampleRate, 0.02f);
 	laneBFilterCutoff.reset(newSampleRate, 0.02f);
@@ -1208,41 +1337,275 @@ void APAudioProcessor::prepareToPlay(
 	*dcFilter.state = *juce::dsp::IIR::Coefficients<float>::makeHighPass(
 		newSampleRate, 40.0f);
 	dcFilter.prepare(spec);
+
+	setLatencySamples(pipelineLatency);
+	if (pipelined)
+		startFXPipeline();
+}
+
+void APAudioProcessor::releaseResources()
+{
+	fxPipeline.stop();
+}
+
+void APAudioProcessor::setNonRealtime(const bool isNonRealtime) noexcept
+{
+	Processor::setNonRealtime(isNonRealtime);
+
+	// Hosts flag a bounce before its first block, usually from the message
+	// thread: switch profiles there and then, so the whole bounce renders
+	// with one. Anywhere else (some wrappers set the flag from the audio
+	// thread) the profile waits for the host's next prepareToPlay.
+	if (isNonRealtime == offline || getSampleRate() <= 0.0)
+		return;
+	if (!juce::MessageManager::existsAndIsCurrentThread())
+		return;
+
+	// waits out the block in progress; the host sees silence until it's done
+	suspendProcessing(true);
+	prepareToPlay(getSampleRate(), getBlockSize());
+	suspendProcessing(false);
+}
+
+void APAudioProcessor::updatePolyphony()
+{
+	// the voices are all there already, so this never allocates
+	const int newNumVoices = juce::jlimit(1, maxVoices, globalParams.polyphony->getUserValueInt());
+	if (newNumVoices == numVoices)
+		return;
+
+	numVoices = newNumVoices;
+	synth.setNumVoices(numVoices);
+	auxSynth.setNumVoices(numVoices);
 }
 
-void APAudioProcessor::releaseResources() {}
+int APAudioProcessor::getOversamplingFactor() const
+{
+	if (quality.oversampling > 0)
+		return quality.oversampling;
+	return 1 << juce::jlimit(0, 3, globalParams.oversampling->getUserValueInt());
+}
 
-void APAudioProcessor::downsampleStage1(
-	const juce::dsp::AudioBlock<float> &inputBlock,
-	juce::dsp::AudioBlock<float> &outputBlock)
+int APAudioProcessor::getControlBlockSize() const
 {
-	const auto inSamplesL = inputBlock.getChannelPointer(0);
-	const auto inSamplesR = inputBlock.getChannelPointer(1);
-	const auto outSamplesL = outputBlock.getChannelPointer(0);
-	const auto outSamplesR = outputBlock.getChannelPointer(1);
+	return 16 << juce::jlimit(0, 4, globalParams.controlBlock->getUserValueInt());
+}
 
-	const int samples = static_cast<int>(outputBlock.getNumSamples());
-	dspl1L.process_block(outSamplesL, inSamplesL, samples);
-	dspl1R.process_block(outSamplesR, inSamplesR, samples);
+float APAudioProcessor::getLongestDelayTime() const
+{
+	if (stereoDelayParams.temposync->getUserValue() <= 0.0f)
+		return std::max(stereoDelayParams.timeleft->getUserValue(), stereoDelayParams.timeright->getUserValue());
+	// no playhead outside processBlock, so gin gives the note lengths at
+	// 120 bpm: scale them to the session's tempo, as last seen
+	auto &notes = gin::NoteDuration::getNoteDurations();
+	const auto scale = static_cast<float>(120.0 / lastBpm.load(std::memory_order_relaxed));
+	return scale * std::max(notes[static_cast<size_t>(stereoDelayParams.beatsleft->getUserValue())].toSeconds(nullptr),
+		notes[static_cast<size_t>(stereoDelayParams.beatsright->getUserValue())].toSeconds(nullptr));
+}
+
+bool APAudioProcessor::wantsFXPipeline() const
+{
+	return quality.fxPipeline && globalParams.fxPipeline->isOn();
+}
+
+void APAudioProcessor::startFXPipeline()
+{
+	fxPipeline.start();
+	clearFXPipeline();
+}
+
+void APAudioProcessor::clearFXPipeline()
+{
+	fxPipeline.flush();
+	for (auto &slot : fxSlots)
+	{
+		slot.numSamples = 0;
+		slot.numFrames = 0;
+	}
+	primeRemaining = pipelineLatency;
+	playOffset = 0;
 }
-void APAudioProcessor::downsampleStage2(
-	const juce::dsp::AudioBlock<float> &inputBlock,
-	juce::dsp::AudioBlock<float> &outputBlock)
+
+void APAudioProcessor::pushToFXPipeline(juce::AudioBuffer<float> &buffer, juce::AudioBuffer<float> &aux)
 {
-	const auto inSamplesL = inputBlock.getChannelPointer(0);
-	const auto inSamplesR = inputBlock.getChannelPointer(1);
-	const auto outSamplesL = outputBlock.getChannelPointer(0);
-	const auto outSamplesR = outputBlock.getChannelPointer(1);
-	const int samples = static_cast<int>(outputBlock.getNumSamples());
-	dspl2L.process_block(outSamplesL, inSamplesL, samples);
-	dspl2R.process_block(outSamplesR, inSamplesR, samples);
+	const int numSamples = buffer.getNumSamples();
+	for (int done = 0; done < numSamples;)
+	{
+		auto &slot = fxSlots[static_cast<size_t>(fxPipeline.getFillingSlot())];
+		const int take = std::min(numSamples - done, pipelineLatency - slot.numSamples);
+		for (int ch = 0; ch < 2; ch++)
+		{
+			std::copy_n(buffer.getReadPointer(ch, done), take, slot.main[ch] + slot.numSamples);
+			if (fxFrame.auxPostFX)
+				std::copy_n(aux.getReadPointer(ch, done), take, slot.aux[ch] + slot.numSamples);
+		}
+
+		if (slot.numFrames < maxFramesPerSlot)
+		{
+			auto &frame = slot.frames[slot.numFrames++];
+			frame = fxFrame;
+			frame.resetDelay = fxFrame.resetDelay && done == 0;
+			frame.numSamples = take;
+		}
+		else
+		{
+			// can't happen with the slots sized as they are; if it ever
+			// does, the last frame stretches, with the latest values and
+			// without losing a delay reset
+			jassertfalse;
+			auto &frame = slot.frames[slot.numFrames - 1];
+			const int stretched = frame.numSamples + take;
+			const bool resetDelay = frame.resetDelay || (fxFrame.resetDelay && done == 0);
+			frame = fxFrame;
+			frame.resetDelay = resetDelay;
+			frame.numSamples = stretched;
+		}
+
+		slot.numSamples += take;
+		done += take;
+		if (slot.numSamples == pipelineLatency)
+		{
+			fxPipeline.submit();
+			auto &next = fxSlots[static_cast<size_t>(fxPipeline.getFillingSlot())];
+			next.numSamples = 0;
+			next.numFrames = 0;
+		}
+	}
+}
+
+void APAudioProcessor::pullFromFXPipeline(juce::AudioBuffer<float> &out)
+{
+	// pipelineLatency of silence first, then the slots in turn. A slot is
+	// submitted once its last sample is in, which is always before that
+	// sample is due out, so this only waits when the worker is behind.
+	const int numSamples = out.getNumSamples();
+	int done = std::min(numSamples, primeRemaining);
+	if (done > 0)
+	{
+		out.clear(0, done);
+		primeRemaining -= done;
+	}
+
+	while (done < numSamples)
+	{
+		const auto &slot = fxSlots[static_cast<size_t>(fxPipeline.waitForPlayable())];
+		const int take = std::min(numSamples - done, pipelineLatency - playOffset);
+		for (int ch = 0; ch < 2; ch++)
+			std::copy_n(slot.main[ch] + playOffset, take, out.getWritePointer(ch, done));
+		playOffset += take;
+		done += take;
+		if (playOffset == pipelineLatency)
+		{
+			playOffset = 0;
+			fxPipeline.release();
+		}
+	}
+}
+
+void APAudioProcessor::processSlot(const int index)
+{
+	auto &slot = fxSlots[static_cast<size_t>(index)];
+	int pos = 0;
+	for (int f = 0; f < slot.numFrames; f++)
+	{
+		const auto &frame = slot.frames[f];
+		juce::AudioBuffer<float> buffer(slot.main, 2, pos, frame.numSamples);
+		juce::AudioBuffer<float> aux(slot.aux, 2, pos, frame.numSamples);
+		runEffects(frame, buffer, aux);
+		pos += frame.numSamples;
+	}
+}
+
+void APAudioProcessor::ReprepareRequest::handleAsyncUpdate()
+{
+	if (proc.getSampleRate() <= 0.0)
+		return;
+	if (proc.getOversamplingFactor() == proc.oversampling && proc.getControlBlockSize() == proc.controlBlock
+		&& proc.wantsFXPipeline() == proc.pipelined)
+		return;
+
+	// waits out the block in progress; the host sees silence until it's done
+	proc.suspendProcessing(true);
+	proc.prepareToPlay(proc.getSampleRate(), proc.getBlockSize());
+	proc.suspendProcessing(false);
+}
+
+void APAudioProcessor::decimate(
+	juce::AudioBuffer<float> &voiceRate, juce::AudioBuffer<float> &out, const int numSamples)
+{
+	float *inL = voiceRate.getWritePointer(0);
+	float *inR = voiceRate.getWritePointer(1);
+	float *outL = out.getWritePointer(0);
+	float *outR = out.getWritePointer(1);
+
+	switch (oversampling)
+	{
+	case 1:
+		std::copy_n(inL, numSamples, outL);
+		std::copy_n(inR, numSamples, outR);
+		break;
+	case 2:
+		dspl2.processBlock(outL, outR, inL, inR, numSamples);
+		break;
+	case 8:
+		// in place: each output sample only needs input at or after its own index
+		dspl0.processBlock(inL, inR, inL, inR, numSamples * 4);
+		[[fallthrough]];
+	default:
+		dspl12.processBlock(outL, outR, inL, inR, numSamples);
+		break;
+	}
 }
 
 void APAudioProcessor::processBlock(
 	juce::AudioBuffer<float> &buffer, juce::MidiBuffer &midi)
+{
+	// a delay time past what the delay memory holds: it plays clamped until
+	// more is allocated and the delay has spliced it in. A bounce can't
+	// count on the message loop, and nothing is real time then anyway
+	if (stereoDelay.needsMoreMemory())
+	{
+		if (isNonRealtime())
+			stereoDelay.grow();
+		else
+			delayMemoryRequest.triggerAsyncUpdate();
+	}
+
+	const ScopedAllocationTrap trap;
+
+	const auto numSamples = buffer.getNumSamples();
+	if (numSamples <= maxBlockSize)
+	{
+		processChunk(buffer, midi);
+		return;
+	}
+
+	// more than the host promised in prepareToPlay (or it never called it):
+	// go through in pieces the scratch buffers were sized for
+	jassert(maxBlockSize > 0);
+	if (maxBlockSize <= 0)
+	{
+		buffer.clear();
+		return;
+	}
+
+	for (int start = 0; start < numSamples; start += maxBlockSize)
+	{
+		const int len = std::min(maxBlockSize, numSamples - start);
+		juce::AudioBuffer<float> chunk(buffer.getArrayOfWritePointers(), buffer.getNumChannels(), start, len);
+		chunkMidi.clear();
+		chunkMidi.addEvents(midi, start, len, -start);
+		processChunk(chunk, chunkMidi);
+	}
+}
+
+void APAudioProcessor::processChunk(
+	juce::AudioBuffer<float> &buffer, juce::MidiBuffer &midi)
 {
 	juce::ScopedNoDenormals noDenormals;
 
+	tuning.update(client);
+
 	const auto numSamples = buffer.getNumSamples();
 	tillReset -= numSamples;
 	if (tillReset <= 0)
@@ -1280,27 +1643,13 @@ void APAudioProcessor::processBlock(
 		viz2.algo = timbreParams.algo->getProcValue();
 	}
 
-	if (MTS_HasMaster(client))
-	{
-		scaleName = MTS_GetScaleName(client);
-	}
-
-	if (modMatrix.getLearn().id != -1)
-	{
-		learning = "Learning: " + modMatrix.getModSrcName(modMatrix.getLearn());
-	}
-	else
-	{
-		learning = "";
-	}
-
 	if (presetLoaded)
 	{
 		presetLoaded = false;
 		synth.shutItDown();
 		synth.turnOffAllVoices(false);
 		auxSynth.turnOffAllVoices(false);
-		stereoDelay.resetBuffers();
+		delayResetPending = true;
 	}
 
 	synth.startBlock();
@@ -1310,36 +1659,41 @@ void APAudioProcessor::processBlock(
 	auxSynth.setMPE(globalParams.mpe->isOn());
 
 	playhead = getPlayHead();
+	blockPlayHead.position = playhead != nullptr ? playhead->getPosition() : juce::Optional<juce::AudioPlayHead::PositionInfo>{};
+	if (blockPlayHead.position.hasValue())
+	{
+		if (const auto bpm = blockPlayHead.position->getBpm(); bpm.hasValue() && *bpm > 0.0)
+			lastBpm.store(*bpm, std::memory_order_relaxed);
+	}
 
 	int pos = 0;
 	int todo = numSamples;
 
 	buffer.clear(); // then clear it from output buffer
 
+	updatePolyphony();
 	synth.setMono(globalParams.mono->isOn());
 	synth.setLegato(globalParams.legato->isOn());
 	synth.setGlissando(globalParams.glideMode->getUserValue() == 1.0f);
 	synth.setPortamento(globalParams.glideMode->getUserValue() == 2.0f);
 	synth.setGlideRate(globalParams.glideRate->getUserValue());
-	synth.setNumVoices(numVoices);
 
 	auxSynth.setMono(globalParams.mono->isOn());
 	auxSynth.setLegato(globalParams.legato->isOn());
 	auxSynth.setGlissando(globalParams.glideMode->getUserValue() == 1.0f);
 	auxSynth.setPortamento(globalParams.glideMode->getUserValue() == 2.0f);
 	auxSynth.setGlideRate(globalParams.glideRate->getUserValue());
-	auxSynth.setNumVoices(numVoices);
 
-	synthBuffer.setSize(2, numSamples * 2, false, false, true);
-	synthBuffer.clear();
-	preSynthBuffer.setSize(2, numSamples * 4, false, false, true);
+	preSynthBuffer.setDataToReferTo(preSynthChannels, 2, numSamples * oversampling);
 	preSynthBuffer.clear();
-	auxBuffer.setSize(2, numSamples, false, false, true);
+	auxBuffer.setDataToReferTo(auxChannels, 2, numSamples);
 	auxBuffer.clear();
 
+	// params, mod matrix and effects advance once per control block; the
+	// voices render it in chunks of at most voiceChunk
 	while (todo > 0)
 	{
-		const int thisBlock = std::min(todo, MINI_BLOCK_SIZE);
+		const int thisBlock = std::min(todo, controlBlock);
 		updateParams(thisBlock);
 
 		if (auxParams.enable->isOn())
@@ -1347,38 +1701,32 @@ void APAudioProcessor::processBlock(
 			auxSynth.renderNextBlock(auxBuffer, midi, pos, thisBlock);
 		}
 
-		synth.renderNextBlock(preSynthBuffer, midi, pos * 4, thisBlock * 4);
+		for (int done = 0; done < thisBlock; done += voiceChunk)
+		{
+			const int chunk = std::min(voiceChunk, thisBlock - done);
+			synth.renderNextBlock(preSynthBuffer, midi, (pos + done) * oversampling, chunk * oversampling);
+		}
 		auto preSynthBufferSlice =
-			gin::sliceBuffer(preSynthBuffer, pos * 4, thisBlock * 4);
-		auto preSynthBufferSliceBlock =
-			juce::dsp::AudioBlock<float>(preSynthBufferSlice);
-
-		auto synthBufferSlice =
-			gin::sliceBuffer(synthBuffer, pos * 2, thisBlock * 2);
-		auto synthBufferSliceBlock =
-			juce::dsp::AudioBlock<float>(synthBufferSlice);
+			gin::sliceBuffer(preSynthBuffer, pos * oversampling, thisBlock * oversampling);
 
 		auto bufferSlice = gin::sliceBuffer(buffer, pos, thisBlock);
-		auto bufferSliceBlock = juce::dsp::AudioBlock<float>(bufferSlice);
+		decimate(preSynthBufferSlice, bufferSlice, thisBlock);
 
-		downsampleStage1(preSynthBufferSliceBlock, synthBufferSliceBlock);
-		downsampleStage2(synthBufferSliceBlock, bufferSliceBlock);
+		if (voiceFilterMode == SynthVoice3::FilterMode::shared)
+			sharedFilter.process(bufferSlice);
 
 		auxSlice = gin::sliceBuffer(auxBuffer, pos, thisBlock);
 
-		if (auxParams.prefx->isOn())
-		{
-			bufferSlice.addFrom(0, 0, auxBuffer, 0, pos, thisBlock);
-			bufferSlice.addFrom(1, 0, auxBuffer, 1, pos, thisBlock);
-			applyEffects(bufferSlice);
-		}
-		if (!auxParams.prefx->isOn())
+		fxFrame.auxPostFX = !auxParams.prefx->isOn();
+		if (!fxFrame.auxPostFX)
 		{
-			applyEffects(bufferSlice);
-			outputGain.process(auxSlice);
 			bufferSlice.addFrom(0, 0, auxBuffer, 0, pos, thisBlock);
 			bufferSlice.addFrom(1, 0, auxBuffer, 1, pos, thisBlock);
 		}
+		if (pipelined)
+			pushToFXPipeline(bufferSlice, auxSlice);
+		else
+			runEffects(fxFrame, bufferSlice, auxSlice);
 
 		modMatrix.finishBlock(thisBlock);
 
@@ -1388,6 +1736,9 @@ void APAudioProcessor::processBlock(
 
 	playhead = nullptr;
 
+	if (pipelined)
+		pullFromFXPipeline(buffer);
+
 	levelTracker.trackBuffer(buffer);
 
 	synth.endBlock(numSamples * 2);
@@ -1399,351 +1750,163 @@ juce::Array<float> APAudioProcessor::getLiveFilterCutoff() const
 	return synth.getLiveFilterCutoff();
 }
 
-void APAudioProcessor::applyEffects(juce::AudioSampleBuffer &fxALaneBuffer)
+// FX plan steps. An effect step runs whatever sits in the slot on the lane
+// it's bound to; runLaneFilter is the lane's filter, gain and pan
+template <auto effect>
+static void runEffect(APAudioProcessor &p, juce::AudioBuffer<float> &buffer, juce::AudioBuffer<float> &)
 {
-	// knowing which effects are active is now handled in updateParams()
+	auto block = juce::dsp::AudioBlock<float>(buffer);
+	(p.*effect).process(juce::dsp::ProcessContextReplacing<float>(block));
+}
 
-	const int numSamples = fxALaneBuffer.getNumSamples();
-	const float laneAQ =
-		gin::Q /
-		(1.0f - (modMatrix.getValue(fxOrderParams.laneARes) / 100.0f) * 0.99f);
-	const float laneBQ =
-		gin::Q /
-		(1.0f - (modMatrix.getValue(fxOrderParams.laneBRes) / 100.0f) * 0.99f);
-	const bool laneAPre = fxOrderParams.laneAPrePost->getUserValue() < 0.5f;
-	const bool laneBPre = fxOrderParams.laneBPrePost->getUserValue() < 0.5f;
-	const float laneAPan = modMatrix.getValue(fxOrderParams.laneAPan);
-	const float laneBPan = modMatrix.getValue(fxOrderParams.laneBPan);
+static void runCompressor(APAudioProcessor &p, juce::AudioBuffer<float> &buffer, juce::AudioBuffer<float> &)
+{
+	p.compressor.process(buffer);
+}
 
-	switch (static_cast<int>(fxOrderParams.laneAType->getUserValue()))
-	{
-	case 0:
-		laneAFilter.setType(gin::Filter::lowpass);
-		laneAFilter.setSlope(gin::Filter::db12);
-		break;
-	case 1:
-		laneAFilter.setType(gin::Filter::lowpass);
-		laneAFilter.setSlope(gin::Filter::db24);
-		break;
-	case 2:
-		laneAFilter.setType(gin::Filter::highpass);
-		laneAFilter.setSlope(gin::Filter::db12);
-		break;
-	case 3:
-		laneAFilter.setType(gin::Filter::highpass);
-		laneAFilter.setSlope(gin::Filter::db24);
-		break;
-	case 4:
-		laneAFilter.setType(gin::Filter::bandpass);
-		laneAFilter.setSlope(gin::Filter::db12);
-		break;
-	case 5:
-		laneAFilter.setType(gin::Filter::bandpass);
-		laneAFilter.setSlope(gin::Filter::db24);
-		break;
-	case 6:
-		laneAFilter.setType(gin::Filter::notch);
-		laneAFilter.setSlope(gin::Filter::db12);
-		break;
-	case 7:
-		laneAFilter.setType(gin::Filter::notch);
-		laneAFilter.setSlope(gin::Filter::db24);
-		break;
-	}
+template <int lane>
+static void runLaneFilter(APAudioProcessor &p, juce::AudioBuffer<float> &buffer, juce::AudioBuffer<float> &)
+{
+	const int numSamples = buffer.getNumSamples();
+	(lane == FXPlan::laneA ? p.laneAFilter : p.laneBFilter).process(buffer);
+	buffer.applyGain(0, 0, numSamples, p.laneGains[lane][0]);
+	buffer.applyGain(1, 0, numSamples, p.laneGains[lane][1]);
+}
 
-	float f =
-		gin::getMidiNoteInHertz(modMatrix.getValue(fxOrderParams.laneAFreq));
-	laneAFilterCutoff.setTargetValue(f);
-	laneAFilter.setParams(laneAFilterCutoff.getCurrentValue(), laneAQ);
-	laneAFilterCutoff.skip(numSamples);
+static void copyFromOtherLane(APAudioProcessor &, juce::AudioBuffer<float> &buffer, juce::AudioBuffer<float> &other)
+{
+	buffer.copyFrom(0, 0, other, 0, 0, buffer.getNumSamples());
+	buffer.copyFrom(1, 0, other, 1, 0, buffer.getNumSamples());
+}
 
-	switch (static_cast<int>(fxOrderParams.laneBType->getUserValue()))
-	{
-	case 0:
-		laneBFilter.setType(gin::Filter::lowpass);
-		laneBFilter.setSlope(gin::Filter::db12);
-		break;
-	case 1:
-		laneBFilter.setType(gin::Filter::lowpass);
-		laneBFilter.setSlope(gin::Filter::db24);
-		break;
-	case 2:
-		laneBFilter.setType(gin::Filter::highpass);
-		laneBFilter.setSlope(gin::Filter::db12);
-		break;
-	case 3:
-		laneBFilter.setType(gin::Filter::highpass);
-		laneBFilter.setSlope(gin::Filter::db24);
-		break;
-	case 4:
-		laneBFilter.setType(gin::Filter::bandpass);
-		laneBFilter.setSlope(gin::Filter::db12);
-		break;
-	case 5:
-		laneBFilter.setType(gin::Filter::bandpass);
-		laneBFilter.setSlope(gin::Filter::db24);
-		break;
-	case 6:
-		laneBFilter.setType(gin::Filter::notch);
-		laneBFilter.setSlope(gin::Filter::db12);
-		break;
-	case 7:
-		laneBFilter.setType(gin::Filter::notch);
-		laneBFilter.setSlope(gin::Filter::db24);
-		break;
-	}
+static void addFromOtherLane(APAudioProcessor &, juce::AudioBuffer<float> &buffer, juce::AudioBuffer<float> &other)
+{
+	buffer.addFrom(0, 0, other, 0, 0, buffer.getNumSamples());
+	buffer.addFrom(1, 0, other, 1, 0, buffer.getNumSamples());
+}
 
-	f = gin::getMidiNoteInHertz(modMatrix.getValue(fxOrderParams.laneBFreq));
-	laneBFilterCutoff.setTargetValue(f);
-	laneBFilter.setParams(laneBFilterCutoff.getCurrentValue(), laneBQ);
-	laneBFilterCutoff.skip(numSamples);
+// by effect choice, in fxListTextFunction order; 0 is an empty slot
+static constexpr FXPlan::Run effectSteps[] = {
+	nullptr,
+	runEffect<&APAudioProcessor::waveshaper>,
+	runCompressor,
+	runEffect<&APAudioProcessor::stereoDelay>,
+	runEffect<&APAudioProcessor::chorus>,
+	runEffect<&APAudioProcessor::mbfilter>,
+	runEffect<&APAudioProcessor::reverb>,
+	runEffect<&APAudioProcessor::ringmod>,
+	runEffect<&APAudioProcessor::effectGain>,
+	runEffect<&APAudioProcessor::ladder>,
+};
+
+void APAudioProcessor::compileFXPlan()
+{
+	auto &plan = fxPlans.edit();
+	plan = FXPlan{};
 
-	// case 1: lane A feeds into lane B
-	if (fxOrderParams.chainAtoB->isOn())
+	const auto addEffects = [&plan](std::initializer_list<gin::Parameter *> slots, const FXPlan::Lane lane)
 	{
-		auto outBlock = juce::dsp::AudioBlock<float>(fxALaneBuffer);
-		const auto outContext = juce::dsp::ProcessContextReplacing<float>(outBlock);
-
-		if (laneAPre)
+		for (auto *slot : slots)
 		{
-			laneAFilter.process(fxALaneBuffer);
-			const float gain = juce::Decibels::decibelsToGain(fxOrderParams.laneAGain->getUserValue());
-			fxALaneBuffer.applyGain(0, 0, numSamples, gain * std::min(1 - laneAPan, 1.0f));
-			fxALaneBuffer.applyGain(1, 0, numSamples, gain * std::min(1 + laneAPan, 1.0f));
+			const int fx = juce::jlimit(0, static_cast<int>(std::size(effectSteps)) - 1, slot->getUserValueInt());
+			if (fx == 0)
+				continue;
+			plan.add(effectSteps[fx], lane);
+			plan.activeEffects |= 1u << fx;
 		}
+	};
 
-		for (const int fx : {fxa1, fxa2, fxa3, fxa4})
-		{
-			switch (fx)
-			{
-			case 0:
-				break;
-			case 1:
-				waveshaper.process(outContext);
-				break;
-			case 2:
-				compressor.process(fxALaneBuffer);
-				break;
-			case 3:
-				stereoDelay.process(outContext);
-				break;
-			case 4:
-				chorus.process(outContext);
-				break;
-			case 5:
-				mbfilter.process(outContext);
-				break;
-			case 6:
-				reverb.process(outContext);
-				break;
-			case 7:
-				ringmod.process(outContext);
-				break;
-			case 8:
-				effectGain.process(outContext);
-				break;
-			case 9:
-				ladder.process(outContext);
-				break;
-			default:
-				break;
-			}
-		}
+	const auto &o = fxOrderParams;
+	const bool laneAPre = o.laneAPrePost->getUserValue() < 0.5f;
+	const bool laneBPre = o.laneBPrePost->getUserValue() < 0.5f;
+	plan.laneAType = o.laneAType->getUserValueInt();
+	plan.laneBType = o.laneBType->getUserValueInt();
 
+	if (o.chainAtoB->isOn())
+	{
+		// lane A feeds into lane B, all in the one buffer
+		plan.laneGainScale = 1.0f;
+		if (laneAPre)
+			plan.add(runLaneFilter<FXPlan::laneA>, FXPlan::laneA);
+		addEffects({o.fxa1, o.fxa2, o.fxa3, o.fxa4}, FXPlan::laneA);
 		if (!laneAPre)
-		{
-			laneAFilter.process(fxALaneBuffer);
-			const float gain = juce::Decibels::decibelsToGain(
-				fxOrderParams.laneAGain->getUserValue());
-			fxALaneBuffer.applyGain(
-				0, 0, numSamples, gain * std::min(1 - laneAPan, 1.0f));
-			fxALaneBuffer.applyGain(
-				1, 0, numSamples, gain * std::min(1 + laneAPan, 1.0f));
-		}
-
+			plan.add(runLaneFilter<FXPlan::laneA>, FXPlan::laneA);
 		if (laneBPre)
-		{
-			laneBFilter.process(fxALaneBuffer);
-			const float gain = juce::Decibels::decibelsToGain(
-				fxOrderParams.laneBGain->getUserValue());
-			fxALaneBuffer.applyGain(
-				0, 0, numSamples, gain * std::min(1 - laneBPan, 1.0f));
-			fxALaneBuffer.applyGain(
-				1, 0, numSamples, gain * std::min(1 + laneBPan, 1.0f));
-		}
-
-		for (const int fx : {fxb1, fxb2, fxb3, fxb4})
-		{
-			switch (fx)
-			{
-			case 0:
-				break;
-			case 1:
-				waveshaper.process(outContext);
-				break;
-			case 2:
-				compressor.process(fxALaneBuffer);
-				break;
-			case 3:
-				stereoDelay.process(outContext);
-				break;
-			case 4:
-				chorus.process(outContext);
-				break;
-			case 5:
-				mbfilter.process(outContext);
-				break;
-			case 6:
-				reverb.process(outContext);
-				break;
-			case 7:
-				ringmod.process(outContext);
-				break;
-			case 8:
-				effectGain.process(outContext);
-				break;
-			case 9:
-				ladder.process(outContext);
-				break;
-			default:
-				break;
-			}
-		}
-
+			plan.add(runLaneFilter<FXPlan::laneB>, FXPlan::laneA);
+		addEffects({o.fxb1, o.fxb2, o.fxb3, o.fxb4}, FXPlan::laneA);
 		if (!laneBPre)
-		{
-			laneBFilter.process(fxALaneBuffer);
-			const float gain = juce::Decibels::decibelsToGain(
-				fxOrderParams.laneBGain->getUserValue());
-			fxALaneBuffer.applyGain(0, 0, numSamples, gain * std::min(1 - laneBPan, 1.0f));
-			fxALaneBuffer.applyGain(1, 0, numSamples, gain * std::min(1 + laneBPan, 1.0f));
-		}
+			plan.add(runLaneFilter<FXPlan::laneB>, FXPlan::laneA);
 	}
-	// case 2: lanes A and B are run in parallel
 	else
 	{
-		juce::AudioBuffer<float> fxBLaneBuffer;
-		fxBLaneBuffer.makeCopyOf(fxALaneBuffer);
-
+		// lanes A and B run in parallel on copies of the input and are summed
+		plan.laneGainScale = 0.5f;
+		plan.add(copyFromOtherLane, FXPlan::laneB);
 		if (laneAPre)
-		{
-			laneAFilter.process(fxALaneBuffer);
-			const float gain = juce::Decibels::decibelsToGain(fxOrderParams.laneAGain->getUserValue());
-			fxALaneBuffer.applyGain(0, 0, numSamples, gain * 0.5f * std::min(1 - laneAPan, 1.0f));
-			fxALaneBuffer.applyGain(1, 0, numSamples, gain * 0.5f * std::min(1 + laneAPan, 1.0f));
-		}
-
+			plan.add(runLaneFilter<FXPlan::laneA>, FXPlan::laneA);
 		if (laneBPre)
-		{
-			laneBFilter.process(fxBLaneBuffer);
-			const float gain = juce::Decibels::decibelsToGain(fxOrderParams.laneBGain->getUserValue());
-			fxBLaneBuffer.applyGain(0, 0, numSamples, gain * 0.5f * std::min(1 - laneBPan, 1.0f));
-			fxBLaneBuffer.applyGain(1, 0, numSamples, gain * 0.5f * std::min(1 + laneBPan, 1.0f));
-		}
+			plan.add(runLaneFilter<FXPlan::laneB>, FXPlan::laneB);
+		addEffects({o.fxa1, o.fxa2, o.fxa3, o.fxa4}, FXPlan::laneA);
+		addEffects({o.fxb1, o.fxb2, o.fxb3, o.fxb4}, FXPlan::laneB);
+		if (!laneAPre)
+			plan.add(runLaneFilter<FXPlan::laneA>, FXPlan::laneA);
+		if (!laneBPre)
+			plan.add(runLaneFilter<FXPlan::laneB>, FXPlan::laneB);
+		plan.add(addFromOtherLane, FXPlan::laneA);
+	}
 
-		auto ABlock = juce::dsp::AudioBlock<float>(fxALaneBuffer);
-		const auto AContext = juce::dsp::ProcessContextReplacing<float>(ABlock);
-		auto BBlock = juce::dsp::AudioBlock<float>(fxBLaneBuffer);
-		const auto BContext = juce::dsp::ProcessContextReplacing<float>(BBlock);
-		for (const int fx : {fxa1, fxa2, fxa3, fxa4})
-		{
-			switch (fx)
-			{
-			case 0:
-				break;
-			case 1:
-				waveshaper.process(AContext);
-				break;
-			case 2:
-				compressor.process(fxALaneBuffer);
-				break;
-			case 3:
-				stereoDelay.process(AContext);
-				break;
-			case 4:
-				chorus.process(AContext);
-				break;
-			case 5:
-				mbfilter.process(AContext);
-				break;
-			case 6:
-				reverb.process(AContext);
-				break;
-			case 7:
-				ringmod.process(AContext);
-				break;
-			case 8:
-				effectGain.process(AContext);
-				break;
-			case 9:
-				ladder.process(AContext);
-				break;
-			default:
-				break;
-			}
-		}
-		for (const int fx : {fxb1, fxb2, fxb3, fxb4})
-		{
-			switch (fx)
-			{
-			case 0:
-				break;
-			case 1:
-				waveshaper.process(BContext);
-				break;
-			case 2:
-				compressor.process(fxBLaneBuffer);
-				break;
-			case 3:
-				stereoDelay.process(BContext);
-				break;
-			case 4:
-				chorus.process(BContext);
-				break;
-			case 5:
-				mbfilter.process(BContext);
-				break;
-			case 6:
-				reverb.process(BContext);
-				break;
-			case 7:
-				ringmod.process(BContext);
-				break;
-			case 8:
-				effectGain.process(BContext);
-				break;
-			case 9:
-				ladder.process(BContext);
-				break;
-			default:
-				break;
-			}
-		}
+	fxPlans.publish();
+}
 
-		if (!laneAPre)
-		{
-			laneAFilter.process(fxALaneBuffer);
-			const float gain = juce::Decibels::decibelsToGain(
-				fxOrderParams.laneAGain->getUserValue());
-			fxALaneBuffer.applyGain(
-				0, 0, numSamples, gain * 0.5f * std::min(1 - laneAPan, 1.0f));
-			fxALaneBuffer.applyGain(
-				1, 0, numSamples, gain * 0.5f * std::min(1 + laneAPan, 1.0f));
-		}
+void APAudioProcessor::FXPlanRequest::valueUpdated(gin::Parameter *)
+{
+	// automation can come in on any thread, but only the message thread
+	// writes plans
+	if (juce::MessageManager::existsAndIsCurrentThread())
+		proc.compileFXPlan();
+	else
+		triggerAsyncUpdate();
+}
 
-		if (!laneBPre)
-		{
-			laneBFilter.process(fxBLaneBuffer);
-			const float gain = juce::Decibels::decibelsToGain(
-				fxOrderParams.laneBGain->getUserValue());
-			fxBLaneBuffer.applyGain(
-				0, 0, numSamples, gain * 0.5f * std::min(1 - laneBPan, 1.0f));
-			fxBLaneBuffer.applyGain(
-				1, 0, numSamples, gain * 0.5f * std::min(1 + laneBPan, 1.0f));
-		}
+void APAudioProcessor::applyEffects(juce::AudioSampleBuffer &fxALaneBuffer, const FXFrame &frame)
+{
+	// which effects run where is in the plan; this only has this block's values
+	const auto &plan = fxPlans.get();
 
-		fxALaneBuffer.addFrom(0, 0, fxBLaneBuffer, 0, 0, numSamples);
-		fxALaneBuffer.addFrom(1, 0, fxBLaneBuffer, 1, 0, numSamples);
+	const int numSamples = fxALaneBuffer.getNumSamples();
+	const float laneAQ =
+		gin::Q /
+		(1.0f - (fxValue(frame, fxOrderParams.laneARes) / 100.0f) * 0.99f);
+	const float laneBQ =
+		gin::Q /
+		(1.0f - (fxValue(frame, fxOrderParams.laneBRes) / 100.0f) * 0.99f);
+	const float laneAPan = fxValue(frame, fxOrderParams.laneAPan);
+	const float laneBPan = fxValue(frame, fxOrderParams.laneBPan);
+
+	float f =
+		gin::getMidiNoteInHertz(fxValue(frame, fxOrderParams.laneAFreq));
+	laneAFilterCutoff.setTargetValue(f);
+	laneAFilter.setParams(laneAFilterCutoff.getCurrentValue(), laneAQ);
+	laneAFilterCutoff.skip(numSamples);
+
+	f = gin::getMidiNoteInHertz(fxValue(frame, fxOrderParams.laneBFreq));
+	laneBFilterCutoff.setTargetValue(f);
+	laneBFilter.setParams(laneBFilterCutoff.getCurrentValue(), laneBQ);
+	laneBFilterCutoff.skip(numSamples);
+
+	const float laneAGain = juce::Decibels::decibelsToGain(frame.laneAGain) * plan.laneGainScale;
+	const float laneBGain = juce::Decibels::decibelsToGain(frame.laneBGain) * plan.laneGainScale;
+	laneGains[0][0] = laneAGain * std::min(1 - laneAPan, 1.0f);
+	laneGains[0][1] = laneAGain * std::min(1 + laneAPan, 1.0f);
+	laneGains[1][0] = laneBGain * std::min(1 - laneBPan, 1.0f);
+	laneGains[1][1] = laneBGain * std::min(1 + laneBPan, 1.0f);
+
+	laneBBuffer.setDataToReferTo(laneBChannels, 2, numSamples);
+	juce::AudioBuffer<float> *lanes[2]{&fxALaneBuffer, &laneBBuffer};
+	for (int i = 0; i < plan.numSteps; i++)
+	{
+		const auto &step = plan.steps[static_cast<size_t>(i)];
+		step.run(*this, *lanes[step.lane], *lanes[1 - step.lane]);
 	}
 
 	outputGain.process(fxALaneBuffer);
@@ -1767,26 +1930,6 @@ gin::ProcessorOptions APAudioProcessor::getOptions() const
 
 void APAudioProcessor::updateParams(int newBlockSize)
 {
-	// Check which effects are active
-	fxa1 = fxOrderParams.fxa1->getUserValueInt();
-	fxa2 = fxOrderParams.fxa2->getUserValueInt();
-	fxa3 = fxOrderParams.fxa3->getUserValueInt();
-	fxa4 = fxOrderParams.fxa4->getUserValueInt();
-	fxb1 = fxOrderParams.fxb1->getUserValueInt();
-	fxb2 = fxOrderParams.fxb2->getUserValueInt();
-	fxb3 = fxOrderParams.fxb3->getUserValueInt();
-	fxb4 = fxOrderParams.fxb4->getUserValueInt();
-
-	activeEffects.clear();
-	activeEffects.insert(fxa1);
-	activeEffects.insert(fxa2);
-	activeEffects.insert(fxa3);
-	activeEffects.insert(fxa4);
-	activeEffects.insert(fxb1);
-	activeEffects.insert(fxb2);
-	activeEffects.insert(fxb3);
-	activeEffects.insert(fxb4);
-
 	// Update Mono LFOs
 	for (const auto lfoparams :
 		 {&lfo1Params, &lfo2Params, &lfo3Params, &lfo4Params})
@@ -1824,114 +1967,197 @@ void APAudioProcessor::updateParams(int newBlockSize)
 	modMatrix.setMonoValue(macroSrc2, modMatrix.getValue(macroParams.macro2));
 	modMatrix.setMonoValue(macroSrc3, modMatrix.getValue(macroParams.macro3));
 
-	if (activeEffects.contains(1))
+	// after the mono sources, so the voices see this block's values
+	paramSnapshot.update();
+
+	// One filter on the sum only sounds the same as one per voice while
+	// every voice would get the same settings: nothing poly on the filter
+	// and no key tracking. Otherwise fall back to filtering per voice.
+	auto filterMode = static_cast<SynthVoice3::FilterMode>(filterParams.mode->getUserValueInt());
+	if (filterMode == SynthVoice3::FilterMode::shared
+		&& (paramSnapshot.isPolyModulated(filterParams.frequency)
+			|| paramSnapshot.isPolyModulated(filterParams.resonance)
+			|| paramSnapshot.isPolyModulated(filterParams.keyTracking)
+			|| paramSnapshot.get(filterParams.keyTracking) > 0.0f))
+		filterMode = SynthVoice3::FilterMode::perVoice;
+
+	if (filterMode == SynthVoice3::FilterMode::shared)
 	{
-		waveshaper.setGain(modMatrix.getValue(waveshaperParams.drive),
-						   modMatrix.getValue(waveshaperParams.gain));
-		waveshaper.setDry(modMatrix.getValue(waveshaperParams.dry));
-		waveshaper.setWet(modMatrix.getValue(waveshaperParams.wet));
+		if (voiceFilterMode != SynthVoice3::FilterMode::shared)
+			sharedFilter.reset();
+		SynthVoice3::setFilterType(sharedFilter, filterParams.type->getUserValueInt());
+		const float q = gin::Q / (1.0f - (paramSnapshot.get(filterParams.resonance) / 100.0f) * 0.99f);
+		sharedFilter.setParams(
+			juce::jlimit(4.0f, 20000.0f, gin::getMidiNoteInHertz(paramSnapshot.get(filterParams.frequency))), q);
+	}
+	voiceFilterMode = filterMode;
+
+	captureEffects(fxFrame);
+}
+
+void APAudioProcessor::setupFXValues()
+{
+	const auto &ws = waveshaperParams;
+	const auto &cp = compressorParams;
+	const auto &dl = stereoDelayParams;
+	const auto &ch = chorusParams;
+	const auto &mb = mbfilterParams;
+	const auto &rv = reverbParams;
+	const auto &rm = ringmodParams;
+	const auto &ld = ladderParams;
+	const auto &o = fxOrderParams;
+	fxValueParams = {
+		ws.drive, ws.gain, ws.dry, ws.wet, ws.highshelf, ws.hsq, ws.lp,
+		cp.attack, cp.release, cp.threshold, cp.ratio, cp.knee, cp.input, cp.output,
+		dl.feedback, dl.wet, dl.dry, dl.cutoff,
+		ch.rate, ch.depth, ch.delay, ch.feedback, ch.wet, ch.dry,
+		mb.lowshelffreq, mb.lowshelfgain, mb.lowshelfq, mb.peakfreq, mb.peakgain, mb.peakq,
+		mb.highshelffreq, mb.highshelfgain, mb.highshelfq,
+		rv.size, rv.decay, rv.damping, rv.lowpass, rv.predelay, rv.dry, rv.wet,
+		rm.modfreq1, rm.shape1, rm.mix1, rm.modfreq2, rm.shape2, rm.mix2, rm.spread, rm.lowcut, rm.highcut,
+		gainParams.gain,
+		ld.cutoff, ld.drive, ld.reso, ld.gain,
+		o.laneARes, o.laneBRes, o.laneAPan, o.laneBPan, o.laneAFreq, o.laneBFreq,
+		globalParams.level};
+	jassert(fxValueParams.size() <= FXFrame::maxValues);
+
+	int maxModIndex = 0;
+	for (const auto *p : fxValueParams)
+		maxModIndex = std::max(maxModIndex, p->getModIndex());
+	fxValueSlots.assign(static_cast<size_t>(maxModIndex) + 1, 0);
+	for (int i = 0; i < fxValueParams.size(); i++)
+	{
+		jassert(fxValueParams[i]->getModIndex() >= 0);
+		fxValueSlots[static_cast<size_t>(fxValueParams[i]->getModIndex())] = i;
+	}
+}
+
+void APAudioProcessor::captureEffects(FXFrame &frame)
+{
+	for (int i = 0; i < fxValueParams.size(); i++)
+		frame.values[i] = modMatrix.getValue(fxValueParams.getUnchecked(i));
+	frame.laneAGain = fxOrderParams.laneAGain->getUserValue();
+	frame.laneBGain = fxOrderParams.laneBGain->getUserValue();
+
+	// the playhead is only good on the audio thread, so tempo sync is
+	// resolved here
+	if (const bool tempoSync = stereoDelayParams.temposync->getUserValue() > 0.0f; !tempoSync)
+	{
+		frame.delayTimeL = modMatrix.getValue(stereoDelayParams.timeleft);
+		frame.delayTimeR = modMatrix.getValue(stereoDelayParams.timeright);
+	}
+	else
+	{
+		auto &notes = gin::NoteDuration::getNoteDurations();
+		frame.delayTimeL = notes[static_cast<size_t>(modMatrix.getValue(stereoDelayParams.beatsleft))]
+							   .toSeconds(playhead);
+		frame.delayTimeR = notes[static_cast<size_t>(modMatrix.getValue(stereoDelayParams.beatsright))]
+							   .toSeconds(playhead);
+	}
+	frame.resetDelay = delayResetPending.exchange(false);
+}
+
+void APAudioProcessor::updateEffects(const FXFrame &frame)
+{
+	const auto &plan = fxPlans.get();
+	const auto v = [this, &frame](const gin::Parameter *p) { return fxValue(frame, p); };
+
+	if (plan.isActive(1))
+	{
+		waveshaper.setGain(v(waveshaperParams.drive),
+						   v(waveshaperParams.gain));
+		waveshaper.setDry(v(waveshaperParams.dry));
+		waveshaper.setWet(v(waveshaperParams.wet));
 		waveshaper.setFunctionToUse(waveshaperParams.type->getUserValueInt());
 		waveshaper.setHighShelfFreqAndQ(
-			modMatrix.getValue(waveshaperParams.highshelf),
-			modMatrix.getValue(waveshaperParams.hsq));
-		waveshaper.setLPCutoff(modMatrix.getValue(waveshaperParams.lp));
+			v(waveshaperParams.highshelf),
+			v(waveshaperParams.hsq));
+		waveshaper.setLPCutoff(v(waveshaperParams.lp));
 	}
 
-	if (activeEffects.contains(2))
+	if (plan.isActive(2))
 	{
-		compressor.setParams(modMatrix.getValue(compressorParams.attack), 0.0f,
-							 modMatrix.getValue(compressorParams.release),
-							 modMatrix.getValue(compressorParams.threshold),
-							 modMatrix.getValue(compressorParams.ratio),
-							 modMatrix.getValue(compressorParams.knee));
-		compressor.setInputGain(modMatrix.getValue(compressorParams.input));
-		compressor.setOutputGain(modMatrix.getValue(compressorParams.output));
+		compressor.setParams(v(compressorParams.attack), 0.0f,
+							 v(compressorParams.release),
+							 v(compressorParams.threshold),
+							 v(compressorParams.ratio),
+							 v(compressorParams.knee));
+		compressor.setInputGain(v(compressorParams.input));
+		compressor.setOutputGain(v(compressorParams.output));
 		compressor.setMode(static_cast<gin::Dynamics::Type>(compressorParams.type->getUserValueInt()));
 	}
 
-	auto &notes = gin::NoteDuration::getNoteDurations();
-
-	if (activeEffects.contains(3))
+	if (plan.isActive(3))
 	{
-		if (const bool tempoSync = stereoDelayParams.temposync->getUserValue() > 0.0f; !tempoSync)
-		{
-			stereoDelay.setTimeL(modMatrix.getValue(stereoDelayParams.timeleft));
-			stereoDelay.setTimeR(modMatrix.getValue(stereoDelayParams.timeright));
-		}
-		else
-		{
-			stereoDelay.setTimeL(notes[static_cast<size_t>(modMatrix.getValue(stereoDelayParams.beatsleft))]
-									 .toSeconds(playhead));
-			stereoDelay.setTimeR(notes[static_cast<size_t>(modMatrix.getValue(stereoDelayParams.beatsright))]
-									 .toSeconds(playhead));
-		}
-		stereoDelay.setFB(modMatrix.getValue(stereoDelayParams.feedback));
-		stereoDelay.setWet(modMatrix.getValue(stereoDelayParams.wet));
-		stereoDelay.setDry(modMatrix.getValue(stereoDelayParams.dry));
+		stereoDelay.setTimeL(frame.delayTimeL);
+		stereoDelay.setTimeR(frame.delayTimeR);
+		stereoDelay.setFB(v(stereoDelayParams.feedback));
+		stereoDelay.setWet(v(stereoDelayParams.wet));
+		stereoDelay.setDry(v(stereoDelayParams.dry));
 		stereoDelay.setFreeze(stereoDelayParams.freeze->getUserValue() > 0.0f);
 		stereoDelay.setPing(stereoDelayParams.pingpong->getUserValue() > 0.0f);
-		stereoDelay.setCutoff(modMatrix.getValue(stereoDelayParams.cutoff));
+		stereoDelay.setCutoff(v(stereoDelayParams.cutoff));
 	}
 
-	if (activeEffects.contains(4))
+	if (plan.isActive(4))
 	{
-		chorus.setRate(modMatrix.getValue(chorusParams.rate));
-		chorus.setDepth(modMatrix.getValue(chorusParams.depth));
-		chorus.setCentreDelay(modMatrix.getValue(chorusParams.delay));
-		chorus.setFeedback(modMatrix.getValue(chorusParams.feedback));
-		chorus.setWet(modMatrix.getValue(chorusParams.wet));
-		chorus.setDry(modMatrix.getValue(chorusParams.dry));
+		chorus.setRate(v(chorusParams.rate));
+		chorus.setDepth(v(chorusParams.depth));
+		chorus.setCentreDelay(v(chorusParams.delay));
+		chorus.setFeedback(v(chorusParams.feedback));
+		chorus.setWet(v(chorusParams.wet));
+		chorus.setDry(v(chorusParams.dry));
 	}
 
-	if (activeEffects.contains(5))
-	{
-		mbfilter.setParams(modMatrix.getValue(mbfilterParams.lowshelffreq),
-						   modMatrix.getValue(mbfilterParams.lowshelfgain),
-						   modMatrix.getValue(mbfilterParams.lowshelfq),
-						   modMatrix.getValue(mbfilterParams.peakfreq),
-						   modMatrix.getValue(mbfilterParams.peakgain),
-						   modMatrix.getValue(mbfilterParams.peakq),
-						   modMatrix.getValue(mbfilterParams.highshelffreq),
-						   modMatrix.getValue(mbfilterParams.highshelfgain),
-						   modMatrix.getValue(mbfilterParams.highshelfq));
+	if (plan.isActive(5))
+	{
+		mbfilter.setParams(v(mbfilterParams.lowshelffreq),
+						   v(mbfilterParams.lowshelfgain),
+						   v(mbfilterParams.lowshelfq),
+						   v(mbfilterParams.peakfreq),
+						   v(mbfilterParams.peakgain),
+						   v(mbfilterParams.peakq),
+						   v(mbfilterParams.highshelffreq),
+						   v(mbfilterParams.highshelfgain),
+						   v(mbfilterParams.highshelfq));
 	}
 
-	if (activeEffects.contains(6))
+	if (plan.isActive(6))
 	{
-		reverb.setSize(modMatrix.getValue(reverbParams.size));
-		reverb.setDecay(modMatrix.getValue(reverbParams.decay));
-		reverb.setDamping(modMatrix.getValue(reverbParams.damping));
-		reverb.setLowpass(modMatrix.getValue(reverbParams.lowpass));
-		reverb.setPredelay(modMatrix.getValue(reverbParams.predelay));
-		reverb.setDry(modMatrix.getValue(reverbParams.dry));
-		reverb.setWet(modMatrix.getValue(reverbParams.wet));
+		reverb.setSize(v(reverbParams.size));
+		reverb.setDecay(v(reverbParams.decay));
+		reverb.setDamping(v(reverbParams.damping));
+		reverb.setLowpass(v(reverbParams.lowpass));
+		reverb.setPredelay(v(reverbParams.predelay));
+		reverb.setDry(v(reverbParams.dry));
+		reverb.setWet(v(reverbParams.wet));
 	}
 
-	if (activeEffects.contains(7))
+	if (plan.isActive(7))
 	{
 		RingModulator::RingModParams rmparams;
-		rmparams.mod1freq = modMatrix.getValue(ringmodParams.modfreq1);
-		rmparams.shape1 = modMatrix.getValue(ringmodParams.shape1);
-		rmparams.mix1 = modMatrix.getValue(ringmodParams.mix1);
-		rmparams.mod2freq = modMatrix.getValue(ringmodParams.modfreq2);
-		rmparams.shape2 = modMatrix.getValue(ringmodParams.shape2);
-		rmparams.mix2 = modMatrix.getValue(ringmodParams.mix2);
-		rmparams.spread = modMatrix.getValue(ringmodParams.spread);
-		rmparams.lowcut = modMatrix.getValue(ringmodParams.lowcut);
-		rmparams.highcut = modMatrix.getValue(ringmodParams.highcut);
+		rmparams.mod1freq = v(ringmodParams.modfreq1);
+		rmparams.shape1 = v(ringmodParams.shape1);
+		rmparams.mix1 = v(ringmodParams.mix1);
+		rmparams.mod2freq = v(ringmodParams.modfreq2);
+		rmparams.shape2 = v(ringmodParams.shape2);
+		rmparams.mix2 = v(ringmodParams.mix2);
+		rmparams.spread = v(ringmodParams.spread);
+		rmparams.lowcut = v(ringmodParams.lowcut);
+		rmparams.highcut = v(ringmodParams.highcut);
 		ringmod.setParams(rmparams);
 	}
 
-	if (activeEffects.contains(8))
-		effectGain.setGainLevel(modMatrix.getValue(gainParams.gain));
+	if (plan.isActive(8))
+		effectGain.setGainLevel(v(gainParams.gain));
 
 	using LMode = juce::dsp::LadderFilter<float>::Mode;
 
-	if (activeEffects.contains(9))
+	if (plan.isActive(9))
 	{
 		ladder.filter.setCutoffFrequencyHz(
-			gin::getMidiNoteInHertz(modMatrix.getValue(ladderParams.cutoff)));
-		ladder.filter.setDrive(modMatrix.getValue(ladderParams.drive));
+			gin::getMidiNoteInHertz(v(ladderParams.cutoff)));
+		ladder.filter.setDrive(v(ladderParams.drive));
 		juce::dsp::LadderFilter<float>::Mode mode;
 		switch (ladderParams.type->getUserValueInt())
 		{
@@ -1958,12 +2184,34 @@ void APAudioProcessor::updateParams(int newBlockSize)
 			break;
 		}
 		ladder.filter.setMode(mode);
-		ladder.filter.setResonance(modMatrix.getValue(ladderParams.reso));
-		ladder.gain.setGainDecibels(modMatrix.getValue(ladderParams.gain));
+		ladder.filter.setResonance(v(ladderParams.reso));
+		ladder.gain.setGainDecibels(v(ladderParams.gain));
+	}
+
+	outputGain.setGain(v(globalParams.level));
+}
+
+void APAudioProcessor::runEffects(
+	const FXFrame &frame, juce::AudioBuffer<float> &buffer, juce::AudioBuffer<float> &aux)
+{
+	if (fxPlans.update())
+	{
+		SynthVoice3::setFilterType(laneAFilter, fxPlans.get().laneAType);
+		SynthVoice3::setFilterType(laneBFilter, fxPlans.get().laneBType);
 	}
+	if (frame.resetDelay)
+		stereoDelay.resetBuffers();
+
+	updateEffects(frame);
+	applyEffects(buffer, frame);
 
-	// Output gain
-	outputGain.setGain(modMatrix.getValue(globalParams.level));
+	if (frame.auxPostFX)
+	{
+		const int numSamples = buffer.getNumSamples();
+		outputGain.process(aux);
+		buffer.addFrom(0, 0, aux, 0, 0, numSamples);
+		buffer.addFrom(1, 0, aux, 1, 0, numSamples);
+	}
 }
 
 //==============================================================================
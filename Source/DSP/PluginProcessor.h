@@ -23,19 +23,18 @@
 #include <random>
 #include "AuxSynth.h"
 #include "Envelope.h"
+#include "FXPipeline.h"
+#include "FXPlan.h"
 #include "FXProcessors.h"
+#include "ParamSnapshot.h"
+#include "ScratchArena.h"
+#include "StereoDownsampler.h"
 #include "Synth.h"
+#include "TuningTable.h"
 #include "hiir/PolyphaseIir2Designer.h"
-#if USE_NEON
-#include "hiir/Downsampler2x4Neon.h"
-#include "hiir/Downsampler2xNeon.h"
-#endif
-
-#if USE_SSE
-#include "hiir/Downsampler2xSse.h"
-#endif
+#include "hiir/coef/C8x.h"
 //==============================================================================
-class APAudioProcessor : public gin::Processor {
+class APAudioProcessor : public gin::Processor, private FXPipeline::Stage {
 public:
 	//==============================================================================
 	APAudioProcessor();
@@ -47,8 +46,10 @@ public:
 	void reset() override;
 	void prepareToPlay(double sampleRate, int samplesPerBlock) override;
 	void releaseResources() override;
+	void setNonRealtime(bool isNonRealtime) noexcept override;
 
 	void processBlock(juce::AudioBuffer<float> &, juce::MidiBuffer &) override;
+	void processChunk(juce::AudioBuffer<float> &, juce::MidiBuffer &);
 	bool isBusesLayoutSupported(const BusesLayout &layouts) const override;
 	//==============================================================================
 	juce::AudioProcessorEditor *createEditor() override;
@@ -60,17 +61,31 @@ public:
 	void stateUpdated() override;
 	void updateState() override;
 
-	void downsampleStage1(const juce::dsp::AudioBlock<float> &inputBlock,
-	    juce::dsp::AudioBlock<float> &outputBlock);
-	void downsampleStage2(const juce::dsp::AudioBlock<float> &inputBlock,
-	    juce::dsp::AudioBlock<float> &outputBlock);
+	// numSamples * oversampling per channel of voice-rate audio down to
+	// numSamples at the host rate; voiceRate is used as scratch
+	void decimate(juce::AudioBuffer<float> &voiceRate, juce::AudioBuffer<float> &out, int numSamples);
 
 	//==============================================================================
 
 	//==============================================================================
 	juce::Array<float> getLiveFilterCutoff() const;
 
-	void applyEffects(juce::AudioSampleBuffer &buffer);
+	// The effect values for one control block. The audio thread reads them
+	// from the mod matrix, so the effects can run anywhere: inline, or on
+	// the FX pipeline a block later.
+	struct FXFrame {
+		static constexpr int maxValues = 64;
+		float values[maxValues]{};  // the fxValueParams, in order
+		float laneAGain{0.f}, laneBGain{0.f};
+		float delayTimeL{0.f}, delayTimeR{0.f};  // seconds, tempo sync resolved
+		int numSamples{0};  // in the pipeline
+		bool auxPostFX{false}, resetDelay{false};
+	};
+
+	void captureEffects(FXFrame &frame);
+	void updateEffects(const FXFrame &frame);
+	void runEffects(const FXFrame &frame, juce::AudioBuffer<float> &buffer, juce::AudioBuffer<float> &aux);
+	void applyEffects(juce::AudioSampleBuffer &buffer, const FXFrame &frame);
 
 	// Voice Params
 	struct OSCParams {
@@ -86,7 +101,7 @@ public:
 	struct FilterParams {
 		FilterParams() = default;
 
-		gin::Parameter::Ptr type, keyTracking, frequency, resonance;
+		gin::Parameter::Ptr type, keyTracking, frequency, resonance, mode;
 
 		void setup(APAudioProcessor &p);
 
@@ -139,7 +154,8 @@ public:
 		GlobalParams() = default;
 
 		gin::Parameter::Ptr mono, glideMode, glideRate, legato, level, mpe,
-		    velSens, pitchbendRange;
+		    velSens, pitchbendRange, polyphony, renderThreads, silenceThreshold,
+		    silenceHold, oversampling, controlBlock, fxPipeline;
 
 		void setup(APAudioProcessor &p);
 
@@ -250,6 +266,13 @@ public:
 
 		void setup(APAudioProcessor &p);
 
+		// the ones that shape the FX plan rather than feed it values
+		[[nodiscard]] std::array<gin::Parameter *, 13> routing() const
+		{
+			return {fxa1, fxa2, fxa3, fxa4, fxb1, fxb2, fxb3, fxb4, chainAtoB,
+			    laneAPrePost, laneBPrePost, laneAType, laneBType};
+		}
+
 		JUCE_DECLARE_NON_COPYABLE(FXOrderParams)
 	};
 
@@ -329,6 +352,7 @@ public:
 
 	//==============================================================================
 	gin::ModMatrix modMatrix;
+	ParamSnapshot paramSnapshot{modMatrix};
 
 	gin::LFO lfo1, lfo2, lfo3, lfo4;
 	gin::MSEG::Data mseg1Data, mseg2Data, mseg3Data, mseg4Data;
@@ -342,31 +366,156 @@ public:
 
 	
 	juce::AudioPlayHead *playhead = nullptr;
+
+	// the host position, read once per block on the audio thread, for
+	// voices that may be rendering on one of the synth's worker threads
+	struct BlockPlayHead final : juce::AudioPlayHead {
+		juce::Optional<PositionInfo> getPosition() const override { return position; }
+		juce::Optional<PositionInfo> position;
+	};
+	BlockPlayHead blockPlayHead;
+	// the last tempo the host reported, for prepareToPlay, which has no
+	// playhead to ask; 120 bpm until there is one
+	std::atomic<double> lastBpm{120.0};
 	bool presetLoaded = false;
 	gin::Filter laneAFilter, laneBFilter;
+
+	// where the voice filter runs this block (FilterParams::mode, unless the
+	// voices disagree); sharedFilter is the one used in shared mode, at 1x
+	SynthVoice3::FilterMode voiceFilterMode{SynthVoice3::FilterMode::perVoice};
+	gin::Filter sharedFilter;
 	juce::dsp::ProcessorDuplicator<juce::dsp::IIR::Filter<float>,
 	    juce::dsp::IIR::Coefficients<float>>
 	    dcFilter;
 	juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative>
 	    laneAFilterCutoff, laneBFilterCutoff;
-	int fxa1, fxa2, fxa3, fxa4, fxb1, fxb2, fxb3, fxb4;  // effect choices
-	std::unordered_set<int> activeEffects;
+
+	// the effect chain, compiled on the message thread whenever a routing
+	// param changes; runEffects picks up the latest
+	FXPlanExchange fxPlans;
+	void compileFXPlan();
+	struct FXPlanRequest final : gin::Parameter::ParameterListener, juce::AsyncUpdater {
+		explicit FXPlanRequest(APAudioProcessor &p) : proc(p) {}
+		void valueUpdated(gin::Parameter *) override;
+		void handleAsyncUpdate() override { proc.compileFXPlan(); }
+		APAudioProcessor &proc;
+	} fxPlanRequest{*this};
+
+	// the delay's memory follows its times, but only the message thread
+	// allocates; processBlock passes its requests on through here
+	struct DelayMemoryRequest final : juce::AsyncUpdater {
+		explicit DelayMemoryRequest(APAudioProcessor &p) : proc(p) {}
+		void handleAsyncUpdate() override { proc.stereoDelay.grow(); }
+		APAudioProcessor &proc;
+	} delayMemoryRequest{*this};
+	float laneGains[2][2]{};  // by lane and channel; set per block in applyEffects
+	juce::AudioBuffer<float> laneBBuffer;  // parallel routing only
+
+	// what captureEffects reads, and where each lands in FXFrame::values
+	void setupFXValues();
+	juce::Array<gin::Parameter *> fxValueParams;
+	std::vector<int> fxValueSlots;  // by mod index
+	[[nodiscard]] inline float fxValue(const FXFrame &frame, const gin::Parameter *p) const
+	{
+		return frame.values[fxValueSlots[static_cast<size_t>(p->getModIndex())]];
+	}
+	FXFrame fxFrame;  // this control block's, on the audio thread
+	std::atomic<bool> delayResetPending{false};
 
 	gin::LevelTracker levelTracker{20.f};
 	APSynth synth;
 	juce::AudioBuffer<float> auxBuffer;
 	juce::AudioBuffer<float> auxSlice;
-	juce::AudioBuffer<float> synthBuffer;     // 2x
-	juce::AudioBuffer<float> preSynthBuffer;  // 4x
+	juce::AudioBuffer<float> preSynthBuffer;  // at the voice rate
+
+	// Bounces trade CPU for quality, live playback keeps the cheap path;
+	// prepareToPlay picks the profile from isNonRealtime(), and
+	// setNonRealtime re-prepares when it can do so outside processing
+	struct QualityProfile {
+		int oversampling;        // voice rate factor, or 0 to follow the param
+		int voiceControlSamples; // host samples between voice control updates
+		int fxOversampling;      // waveshaper and ring modulator
+		bool fxPipeline;         // allowed to run the effects on the FX pipeline
+	};
+	static constexpr QualityProfile realtimeQuality{0, 128, 2, true}, offlineQuality{8, 16, 4, false};
+	QualityProfile quality{realtimeQuality};
+	bool offline{false};
+
+	// voice rate over host rate: 1, 2, 4 or 8. The param is read in
+	// prepareToPlay; a change while playing re-prepares from the message
+	// thread with processing suspended
+	int oversampling{4};
+	[[nodiscard]] int getOversamplingFactor() const;
+
+	// host samples per updateParams/applyEffects/finishBlock round, 16 to 256,
+	// read in prepareToPlay like the oversampling. Bigger blocks cost less per
+	// sample but step the global modulation more coarsely: at 48 kHz a round
+	// is 0.33, 0.67, 1.3, 2.7 or 5.3 ms, so from 128 up an LFO or envelope
+	// driving an FX parameter steps audibly at audio-rate settings. The
+	// default of 32 matches the old MINI_BLOCK_SIZE slicing; "APBenchmarks
+	// controlblock" times each size. The voices keep their own control pace
+	// (QualityProfile::voiceControlSamples)
+	int controlBlock{32}, voiceChunk{32};
+	[[nodiscard]] int getControlBlockSize() const;
+
+	// the delay memory is sized for this in prepareToPlay, and grows from there
+	[[nodiscard]] float getLongestDelayTime() const;
+
+	// With the fxPipeline param on (it's off by default, and ignored when
+	// rendering offline), the effects run on their own thread a block behind
+	// the synth: processChunk pushes the dry control blocks into slots of
+	// pipelineLatency samples, with their FXFrames, and plays out the slot
+	// the worker finished before. That adds pipelineLatency (the host block
+	// size) of latency, reported from prepareToPlay before the first block.
+	[[nodiscard]] bool wantsFXPipeline() const;
+	void startFXPipeline();
+	void clearFXPipeline();  // drops the slots in flight, keeps the thread
+	void pushToFXPipeline(juce::AudioBuffer<float> &buffer, juce::AudioBuffer<float> &aux);
+	void pullFromFXPipeline(juce::AudioBuffer<float> &out);
+	void processSlot(int slot) override;
+	struct FXSlot {
+		float *main[2]{}, *aux[2]{};  // pipelineLatency samples each, in the scratch arena
+		juce::HeapBlock<FXFrame> frames;
+		int numSamples{0}, numFrames{0};
+	};
+	std::array<FXSlot, FXPipeline::numSlots> fxSlots;
+	int maxFramesPerSlot{0}, pipelineLatency{0};
+	int primeRemaining{0}, playOffset{0};  // audio thread
+	bool pipelined{false};
+	FXPipeline fxPipeline{*this};
+	struct ReprepareRequest final : gin::Parameter::ParameterListener, juce::AsyncUpdater {
+		explicit ReprepareRequest(APAudioProcessor &p) : proc(p) {}
+		void valueUpdated(gin::Parameter *) override { triggerAsyncUpdate(); }
+		void handleAsyncUpdate() override;
+		APAudioProcessor &proc;
+	} reprepare{*this};
+
+	// the buffers above, and every voice's, point into this; a block
+	// longer than maxBlockSize is processed in chunks that fit
+	ScratchArena scratch;
+	float *auxChannels[2]{}, *preSynthChannels[2]{}, *laneBChannels[2]{};
+	int maxBlockSize{0};
+	juce::MidiBuffer chunkMidi;
 
 	MTSClient *client;
-	juce::String scaleName, learning;
+	TuningTable tuning;  // refreshed at the top of each chunk; the voices read it
 
 	AuxSynth auxSynth;
 	gin::BandLimitedLookupTables analogTables;
 	gin::BandLimitedLookupTables upsampledTables;
+	APWavetables orbitTables;  // quadrature tables for the planets, at the oversampled rate
+
+	// both synths own maxVoices voices from construction; the polyphony
+	// param only limits how many of them play. "APBenchmarks voices" times
+	// what each added voice costs
+	static constexpr int maxVoices = 64;
+	int numVoices{8};
+	void updatePolyphony();
 
-	const int numVoices = 8;
+	// voices stopped early because their output stayed under the silence
+	// threshold after note-off; only ever counts up
+	std::atomic<int> voicesRetiredBySilence{0};
+	[[nodiscard]] int getVoicesRetiredBySilence() const { return voicesRetiredBySilence.load(std::memory_order_relaxed); }
 
 	int tillReset{0};
 	const int resetVal{2000};
@@ -379,27 +528,26 @@ public:
 	std::mt19937 gen{rd()};
 	std::uniform_real_distribution<float> dist{-1.f, 1.f};
 
-	// antialiasing downsampling filter stuff
+	// antialiasing downsampling filter stuff: stage 0 takes 8x to 4x, stage 1
+	// 4x to 2x, stage 2 2x to 1x; lower factors skip the leading stages.
+	// Stages 1 and 2 run fused for 4x and up
+	using Stage0Coefs = hiir::coef::C8x133::X8;
+	static constexpr int nbr_coefs0 = Stage0Coefs::_nbr_coef;
 	static constexpr int nbr_coefs1 = 3;
 	static constexpr int nbr_coefs2 = 8;
 	double coefs1[nbr_coefs1];
 	double coefs2[nbr_coefs2];
 
-#if USE_NEON
-	hiir::Downsampler2xNeon<nbr_coefs1> dspl1L, dspl1R;
-	hiir::Downsampler2xNeon<nbr_coefs2> dspl2L, dspl2R;
-#endif
-
-#if USE_SSE
-	hiir::Downsampler2xSse<nbr_coefs1> dspl1L, dspl1R;
-	hiir::Downsampler2xSse<nbr_coefs2> dspl2L, dspl2R;
-#endif
+	StereoDownsampler2x<nbr_coefs0> dspl0;
+	StereoDecimator4x<nbr_coefs1, nbr_coefs2> dspl12;
+	StereoDownsampler2x<nbr_coefs2> dspl2;  // 2x on its own
 
 	bool env1osc1, env1osc2, env1osc3, env1osc4, env2osc1, env2osc2, env2osc3,
 	    env2osc4, env3osc1, env3osc2, env3osc3, env3osc4, env4osc1, env4osc2,
 	    env4osc3, env4osc4;
 
 	std::array<double, 1024> convex;
+	Envelope::Shapes envelopeShapes;  // from convex, in the constructor
 
 	//==============================================================================
 	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(APAudioProcessor)
@@ -0,0 +1,49 @@
+/*
+ * Audible Planets - an expressive, quasi-Ptolemaic semi-modular synthesizer
+ *
+ * Copyright 2024, Greg Recco
+ *
+ * Audible Planets is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * All source for Audible Planets is available at
+ * https://github.com/gregrecco67/AudiblePlanets
+ */
+
+#include "ScratchArena.h"
+#include <algorithm>
+
+size_t ScratchArena::footprint(const size_t numFloats)
+{
+	constexpr size_t floatsPerLine = alignment / sizeof(float);
+	return (numFloats + floatsPerLine - 1) / floatsPerLine * floatsPerLine;
+}
+
+void ScratchArena::reserve(const size_t numFloats)
+{
+	used = 0;
+	const size_t wanted = footprint(numFloats);
+	if (wanted <= capacity && base != nullptr)
+		return;
+
+	block.calloc(wanted * sizeof(float) + alignment);
+	const auto address = reinterpret_cast<std::uintptr_t>(block.get());
+	base = reinterpret_cast<float *>((address + alignment - 1) & ~(static_cast<std::uintptr_t>(alignment) - 1));
+	capacity = wanted;
+}
+
+float *ScratchArena::take(const size_t numFloats)
+{
+	const size_t n = footprint(numFloats);
+	jassert(used + n <= capacity);
+	if (used + n > capacity)
+		return nullptr;
+
+	float *piece = base + used;
+	used += n;
+	std::fill_n(piece, n, 0.f);
+	return piece;
+}
+
@@ -0,0 +1,47 @@
+/*
+ * Audible Planets - an expressive, quasi-Ptolemaic semi-modular synthesizer
+ *
+ * Copyright 2024, Greg Recco
+ *
+ * Audible Planets is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * All source for Audible Planets is available at
+ * https://github.com/gregrecco67/AudiblePlanets
+ */
+
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <cstddef>
+#include <cstdint>
+
+//==============================================================================
+// One aligned block of floats for all the scratch audio the processor and
+// its voices need. prepareToPlay sizes it for the largest block and hands
+// out fixed, cache-line-aligned pieces; the buffers then only ever point into
+// it, so changing their length on the audio thread can't allocate.
+class ScratchArena {
+public:
+	static constexpr size_t alignment = 64;
+
+	// (re)allocates and forgets every piece handed out; off the audio thread
+	void reserve(size_t numFloats);
+
+	// next piece of numFloats, zeroed; jasserts if reserve() was too small
+	float *take(size_t numFloats);
+
+	[[nodiscard]] size_t getNumFloatsUsed() const { return used; }
+	[[nodiscard]] size_t getCapacity() const { return capacity; }
+
+	// what a piece of numFloats really takes, padding included
+	[[nodiscard]] static size_t footprint(size_t numFloats);
+
+private:
+
+	juce::HeapBlock<char> block;
+	float *base{nullptr};
+	size_t capacity{0}, used{0};
+};
@@ -0,0 +1,61 @@
+/*
+ * Audible Planets - an expressive, quasi-Ptolemaic semi-modular synthesizer
+ *
+ * Copyright 2024, Greg Recco
+ *
+ * Audible Planets is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * All source for Audible Planets is available at
+ * https://github.com/gregrecco67/AudiblePlanets
+ */
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#if JUCE_INTEL
+#include <immintrin.h>
+#endif
+
+// one turn of a spin-wait loop: tells the core we're only polling
+inline void cpuRelax() noexcept
+{
+#if JUCE_INTEL
+	_mm_pause();
+#elif JUCE_ARM && !JUCE_MSVC
+	__asm__ __volatile__("yield");
+#else
+	std::this_thread::yield();
+#endif
+}
+
+//==============================================================================
+// Lets a worker sleep until another thread has something for it, without a
+// mutex on the waking side: notify() is one atomic exchange, plus a
+// futex-style wake (std::atomic::notify_one) only when the worker is really
+// asleep, so the audio thread can call it. The worker calls prepareToSleep(),
+// takes one last look for work (and for being asked to exit), and only then
+// sleep()s; a notify() after prepareToSleep() makes sleep() return at once.
+class WakeFlag {
+public:
+	void prepareToSleep() noexcept { state.exchange(asleep); }
+
+	void sleep() noexcept { state.wait(asleep); }
+
+	void cancelSleep() noexcept { state.store(awake, std::memory_order_relaxed); }
+
+	void notify() noexcept
+	{
+		if (state.exchange(awake) == asleep)
+			state.notify_one();
+	}
+
+private:
+	static constexpr uint32_t awake = 0, asleep = 1;
+	std::atomic<uint32_t> state{awake};
+};
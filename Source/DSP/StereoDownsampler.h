@@ -0,0 +1,212 @@
+/*
+ * Audible Planets - an expressive, quasi-Ptolemaic semi-modular synthesizer
+ *
+ * Copyright 2024, Greg Recco
+ *
+ * Audible Planets is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * All source for Audible Planets is available at
+ * https://github.com/gregrecco67/AudiblePlanets
+ */
+
+#pragma once
+
+#include <juce_dsp/juce_dsp.h>
+#include <array>
+
+//==============================================================================
+// A stereo pair in one 4-lane register, {L even, L odd, R even, R odd}: the
+// layout the decimators below work in
+struct StereoLanes {
+	using SIMD = juce::dsp::SIMDRegister<float>;
+	static_assert(SIMD::size() == 4);
+
+	// two consecutive samples of each channel into one register
+	static SIMD load(const float *l, const float *r)
+	{
+#if JUCE_USE_SSE_INTRINSICS
+		const auto lo = _mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64 *>(l));
+		return SIMD::fromNative(_mm_loadh_pi(lo, reinterpret_cast<const __m64 *>(r)));
+#elif JUCE_USE_ARM_NEON
+		return SIMD::fromNative(vcombine_f32(vld1_f32(l), vld1_f32(r)));
+#else
+		alignas(16) const float lanes[4]{l[0], l[1], r[0], r[1]};
+		return SIMD::fromRawArray(lanes);
+#endif
+	}
+
+	// averages each channel's pair: the decimator's output sample
+	static void store(const SIMD x, float *l, float *r)
+	{
+#if JUCE_USE_SSE_INTRINSICS
+		const auto sums = halves(x.value);
+		*l = _mm_cvtss_f32(sums);
+		*r = _mm_cvtss_f32(_mm_movehl_ps(sums, sums));
+#elif JUCE_USE_ARM_NEON
+		const auto sums = halves(x.value);
+		*l = vget_lane_f32(sums, 0);
+		*r = vget_lane_f32(sums, 1);
+#else
+		alignas(16) float lanes[4];
+		x.copyToRawArray(lanes);
+		*l = (lanes[0] + lanes[1]) * 0.5f;
+		*r = (lanes[2] + lanes[3]) * 0.5f;
+#endif
+	}
+
+	// the output samples of two consecutive steps, laid out as the next
+	// stage's input pair, without leaving registers
+	static SIMD pairUp(const SIMD first, const SIMD second)
+	{
+#if JUCE_USE_SSE_INTRINSICS
+		const auto a = halves(first.value), b = halves(second.value);
+		return SIMD::fromNative(_mm_movelh_ps(_mm_unpacklo_ps(a, b), _mm_unpackhi_ps(a, b)));
+#elif JUCE_USE_ARM_NEON
+		const auto z = vzip_f32(halves(first.value), halves(second.value));
+		return SIMD::fromNative(vcombine_f32(z.val[0], z.val[1]));
+#else
+		alignas(16) float a[4], b[4];
+		first.copyToRawArray(a);
+		second.copyToRawArray(b);
+		alignas(16) const float lanes[4]{(a[0] + a[1]) * 0.5f, (b[0] + b[1]) * 0.5f,
+		                                 (a[2] + a[3]) * 0.5f, (b[2] + b[3]) * 0.5f};
+		return SIMD::fromRawArray(lanes);
+#endif
+	}
+
+private:
+#if JUCE_USE_SSE_INTRINSICS
+	// {L, L, R, R}
+	static __m128 halves(const __m128 x)
+	{
+		return _mm_mul_ps(_mm_add_ps(x, _mm_shuffle_ps(x, x, _MM_SHUFFLE(2, 3, 0, 1))), _mm_set1_ps(0.5f));
+	}
+#elif JUCE_USE_ARM_NEON
+	// {L, R}
+	static float32x2_t halves(const float32x4_t x)
+	{
+		return vmul_n_f32(vpadd_f32(vget_low_f32(x), vget_high_f32(x)), 0.5f);
+	}
+#endif
+};
+
+//==============================================================================
+// hiir's 2x polyphase IIR decimator for a stereo pair. Each coefficient pair
+// of the allpass chain is applied to both channels at once, in StereoLanes
+// layout. hiir's mono SSE downsampler only fills two lanes. Each lane goes
+// through the same operations in the same order as in hiir, so the output
+// matches two mono instances sample for sample. "APBenchmarks decimators"
+// times it against them.
+//
+// Coefficients come from hiir::PolyphaseIir2Designer. The input holds
+// 2 * numSamples per channel. Output may overlap input as long as it
+// doesn't start after it.
+template <int NC>
+class StereoDownsampler2x {
+public:
+	using SIMD = StereoLanes::SIMD;
+
+	StereoDownsampler2x()
+	{
+		for (auto &s : stages)
+			s.coef = SIMD(0.f);
+		clearBuffers();
+	}
+
+	void setCoefs(const double coefs[])
+	{
+		// same lane order as hiir: the odd coefficient of each pair takes the
+		// even input sample; an odd count leaves the last stage a passthrough
+		alignas(16) float lanes[numStages + 1][4]{};
+		if (NC < numStages * 2) {
+			lanes[numStages][0] = 1.f;
+			lanes[numStages][2] = 1.f;
+		}
+		for (int i = 0; i < NC; i++) {
+			const int stage = i / 2 + 1;
+			const int pos = (i ^ 1) & 1;
+			lanes[stage][pos] = lanes[stage][pos + 2] = static_cast<float>(coefs[i]);
+		}
+		for (size_t s = 0; s < stages.size(); s++)
+			stages[s].coef = SIMD::fromRawArray(lanes[s]);
+	}
+
+	void clearBuffers()
+	{
+		for (auto &s : stages)
+			s.mem = SIMD(0.f);
+	}
+
+	// one input pair per channel through the allpass chain; the output
+	// sample is the average of each channel's two lanes
+	SIMD process(SIMD x)
+	{
+		for (size_t s = 1; s < stages.size(); s++) {
+			const auto tmp = stages[s - 1].mem;
+			stages[s - 1].mem = x;
+			x = (x - stages[s].mem) * stages[s].coef + tmp;
+		}
+		stages.back().mem = x;
+		return x;
+	}
+
+	void processBlock(float *outL, float *outR, const float *inL, const float *inR, const int numSamples)
+	{
+		jassert(outL <= inL || outL >= inL + numSamples * 2);
+		jassert(outR <= inR || outR >= inR + numSamples * 2);
+
+		for (int i = 0; i < numSamples; i++)
+			StereoLanes::store(process(StereoLanes::load(inL + 2 * i, inR + 2 * i)), outL + i, outR + i);
+	}
+
+private:
+	static constexpr int numStages = (NC + 1) / 2;
+
+	// stage 0 only remembers the input
+	struct Stage {
+		SIMD coef, mem;
+	};
+	std::array<Stage, numStages + 1> stages;
+};
+
+//==============================================================================
+// Two of the above fused, 4x to 1x in one pass: the first stage's two
+// outputs per channel go straight into the second stage in registers, so
+// there is no 2x buffer to write and read back. Same output as running the
+// stages one after the other.
+template <int NC1, int NC2>
+class StereoDecimator4x {
+public:
+	void setCoefs(const double first[], const double second[])
+	{
+		stage1.setCoefs(first);
+		stage2.setCoefs(second);
+	}
+
+	void clearBuffers()
+	{
+		stage1.clearBuffers();
+		stage2.clearBuffers();
+	}
+
+	// the input holds 4 * numSamples per channel; output may overlap it as
+	// long as it doesn't start after it
+	void processBlock(float *outL, float *outR, const float *inL, const float *inR, const int numSamples)
+	{
+		jassert(outL <= inL || outL >= inL + numSamples * 4);
+		jassert(outR <= inR || outR >= inR + numSamples * 4);
+
+		for (int i = 0; i < numSamples; i++) {
+			const auto a = stage1.process(StereoLanes::load(inL + 4 * i, inR + 4 * i));
+			const auto b = stage1.process(StereoLanes::load(inL + 4 * i + 2, inR + 4 * i + 2));
+			StereoLanes::store(stage2.process(StereoLanes::pairUp(a, b)), outL + i, outR + i);
+		}
+	}
+
+private:
+	StereoDownsampler2x<NC1> stage1;
+	StereoDownsampler2x<NC2> stage2;
+};
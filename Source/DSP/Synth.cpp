@@ -6,11 +6,105 @@ APSynth::APSynth(APAudioProcessor &proc_) : proc(proc_)
 	enableLegacyMode(12);
 	setVoiceStealingEnabled(true);
 
-	for (int i = 0; i < 16; i++) {
+	for (int i = 0; i < APAudioProcessor::maxVoices; i++) {
 		auto voice = new SynthVoice3(proc);
 		proc.modMatrix.addVoice(voice);
 		addVoice(voice);
 	}
+	activeVoices.ensureStorageAllocated(voices.size());
+	groups.ensureStorageAllocated(voices.size());
+	banks[0] = std::make_unique<VoiceBank>();
+}
+
+void APSynth::setNumRenderThreads(const int numThreads)
+{
+	pool.setNumThreads(numThreads);
+	for (int i = 0; i < pool.getNumThreads(); i++) {
+		if (banks[static_cast<size_t>(i)] == nullptr)
+			banks[static_cast<size_t>(i)] = std::make_unique<VoiceBank>();
+	}
+}
+
+size_t APSynth::getScratchFloatsNeeded() const
+{
+	return static_cast<size_t>(voices.size()) * 2 * ScratchArena::footprint(SynthVoice3::maxBlockSamples);
+}
+
+void APSynth::assignScratch(ScratchArena &arena)
+{
+	for (auto *v : voices) {
+		auto *left = arena.take(SynthVoice3::maxBlockSamples);
+		auto *right = arena.take(SynthVoice3::maxBlockSamples);
+		static_cast<SynthVoice3 *>(v)->setScratch(left, right);
+	}
+}
+
+void APSynth::setVoiceControlPeriod(const int subBlocks)
+{
+	for (auto *v : voices)
+		static_cast<SynthVoice3 *>(v)->setControlPeriod(subBlocks);
+}
+
+void APSynth::renderNextSubBlock(juce::AudioBuffer<float> &outputAudio, int startSample, int numSamples)
+{
+	const juce::ScopedLock sl(voicesLock);
+
+	activeVoices.clearQuick();
+	for (auto *v : voices) {
+		if (v->isActive())
+			activeVoices.add(static_cast<SynthVoice3 *>(v));
+	}
+
+	// The grouping only depends on the number of voices and the filter mode,
+	// never on the number of threads, so every voice renders the same whoever
+	// picks it up. A bank only pays for itself when it runs the filters too
+	// (see VoiceBank::minVoices); otherwise every voice renders on its own.
+	groups.clearQuick();
+	const int numActive = activeVoices.size();
+	int first = 0;
+	const bool bankable = voiceBanks && proc.voiceFilterMode == SynthVoice3::FilterMode::svfBank;
+	for (; bankable && first < numActive; first += VoiceBank::lanes) {
+		const int count = std::min(VoiceBank::lanes, numActive - first);
+		if (count < VoiceBank::minVoices)
+			break;
+		groups.add({first, count, true});
+	}
+	for (; first < numActive; first++)
+		groups.add({first, 1, false});
+
+	jobSamples = numSamples;
+	if (numActive < minParallelVoices) {
+		for (int g = 0; g < groups.size(); g++)
+			runJob(g, 0);
+	} else {
+		pool.run(*this, groups.size());
+	}
+
+	// mix down on this thread, in voice order, so the sum is the same
+	// bit for bit however many threads rendered it
+	for (auto *v : activeVoices)
+		v->finishVoiceBlock(outputAudio, startSample, numSamples);
+}
+
+void APSynth::runJob(const int job, const int worker)
+{
+	const auto &group = groups.getReference(job);
+	SynthVoice3 *const *groupVoices = activeVoices.getRawDataPointer() + group.first;
+
+	for (int i = 0; i < group.count; i++)
+		groupVoices[i]->prepareBlock(jobSamples);
+
+	// banks only exist in svfBank mode, where they run the filters as well
+	const bool filterInBank = group.banked;
+	if (group.banked) {
+		banks[static_cast<size_t>(worker)]->render(groupVoices, group.count, jobSamples, filterInBank);
+	} else {
+		for (int i = 0; i < group.count; i++)
+			groupVoices[i]->renderOrbits(jobSamples);
+	}
+
+	for (int i = 0; i < group.count; i++)
+		groupVoices[i]->filterBlock(filterInBank);
 }
 
 void APSynth::handleMidiEvent(const juce::MidiMessage &m)
@@ -18,9 +112,11 @@ void APSynth::handleMidiEvent(const juce::MidiMessage &m)
 	MPESynthesiser::handleMidiEvent(m);
 
 	if (m.isSysEx()) {
-		if (MTS_HasMaster(proc.client))
+		if (MTS_HasMaster(proc.client)) {
 			MTS_ParseMIDIDataU(
 			    proc.client, m.getSysExData(), m.getSysExDataSize());
+			proc.tuning.rebuild(proc.client);
+		}
 	}
 
 	if (m.isNoteOn()) {
@@ -2,16 +2,36 @@
 
 #include <gin_dsp/gin_dsp.h>
 #include <juce_audio_basics/juce_audio_basics.h>
+#include <array>
+#include <memory>
+#include "ScratchArena.h"
 #include "SynthVoice3.h"
+#include "VoiceBank.h"
+#include "VoiceRenderPool.h"
 
 class APAudioProcessor;
 
-class APSynth : public gin::Synthesiser {
+class APSynth : public gin::Synthesiser, private VoiceRenderPool::Jobs {
 public:
 	explicit APSynth(APAudioProcessor &proc_);
 	~APSynth() override = default;
 
+	// threads rendering voices, counting the audio thread; call from prepareToPlay
+	void setNumRenderThreads(int numThreads);
+
+	// every voice's synthBuffer, carved out of the processor's arena
+	[[nodiscard]] size_t getScratchFloatsNeeded() const;
+	void assignScratch(ScratchArena &arena);
+
+	// see SynthVoice3::setControlPeriod; call from prepareToPlay
+	void setVoiceControlPeriod(int subBlocks);
+
+	// on by default; Benchmarks/ turns the banks off to time the per-voice
+	// path against them
+	void setVoiceBanksEnabled(const bool enabled) { voiceBanks = enabled; }
+
 	void handleMidiEvent(const juce::MidiMessage &m) override;
+	void renderNextSubBlock(juce::AudioBuffer<float> &outputAudio, int startSample, int numSamples) override;
 	
 	inline juce::Array<float> getLiveFilterCutoff() const
 	{
@@ -181,5 +201,23 @@ public:
 	}
 
 private:
+	void runJob(int job, int worker) override;
+
 	APAudioProcessor &proc;
+
+	// with fewer voices than this, waking the workers costs more than it saves
+	static constexpr int minParallelVoices = 4;
+	VoiceRenderPool pool;
+	std::array<std::unique_ptr<VoiceBank>, VoiceRenderPool::maxThreads> banks;  // one per thread
+
+	// the jobs for a sub-block: a run of activeVoices that either goes
+	// through a VoiceBank or is a single voice rendered on its own
+	struct VoiceGroup {
+		int first, count;
+		bool banked;
+	};
+	juce::Array<SynthVoice3 *> activeVoices;  // reused every sub-block, never reallocated
+	juce::Array<VoiceGroup> groups;           // likewise
+	int jobSamples{0};
+	bool voiceBanks{true};
 };
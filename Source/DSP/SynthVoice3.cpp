@@ -24,9 +24,10 @@
 //==============================================================================
 SynthVoice3::SynthVoice3(APAudioProcessor &p)
     : proc(p), mseg1(proc.mseg1Data), mseg2(proc.mseg2Data),
-      mseg3(proc.mseg3Data), mseg4(proc.mseg4Data), osc1(p.upsampledTables),
-      osc2(p.upsampledTables), osc3(p.upsampledTables), osc4(p.upsampledTables),
-	  env1(p.convex), env2(p.convex), env3(p.convex), env4(p.convex)
+      mseg3(proc.mseg3Data), mseg4(proc.mseg4Data), osc1(p.upsampledTables, p.orbitTables),
+      osc2(p.upsampledTables, p.orbitTables), osc3(p.upsampledTables, p.orbitTables),
+      osc4(p.upsampledTables, p.orbitTables),
+	  env1(p.envelopeShapes), env2(p.envelopeShapes), env3(p.envelopeShapes), env4(p.envelopeShapes)
 {
 	mseg1.reset();
 	mseg2.reset();
@@ -48,6 +49,7 @@ void SynthVoice3::noteStarted()
 		static_cast<char>(curNote.midiChannel))) { return; }
 
 	fastKill = false;
+	silentSamples = 0;
 	startVoice();
 
 	const auto note = getCurrentlyPlayingNote();
@@ -67,6 +69,7 @@ void SynthVoice3::noteStarted()
 	juce::ScopedValueSetter<bool> svs(disableSmoothing, true);
 
 	filter.reset();
+	svf.reset();
 
 	fnz1 = proc.filterParams.frequency->getUserValue(); // in midi note #
 	const float q = gin::Q / (1.0f - (proc.filterParams.resonance->getUserValue() / 100.0f) * 0.99f);
@@ -106,6 +109,7 @@ void SynthVoice3::noteStarted()
 void SynthVoice3::noteRetriggered()
 {
 	// antipop = 0.f;
+	silentSamples = 0;
 	const auto note = getCurrentlyPlayingNote();
 	curNote = getCurrentlyPlayingNote();
 
@@ -179,28 +183,40 @@ void SynthVoice3::noteTimbreChanged()
 	    *this, proc.modSrcTimbre, note.timbre.asUnsignedFloat());
 }
 
+void SynthVoice3::setControlPeriod(const int subBlocks)
+{
+	controlPeriod = std::max(1, subBlocks);
+	tilUpdate = 0;
+	if (getSampleRate() > 0.0)
+		setCurrentSampleRate(getSampleRate());
+}
+
 void SynthVoice3::setCurrentSampleRate(double newRate)
 {
 	MPESynthesiserVoice::setCurrentSampleRate(newRate);
 
-	const auto quarter = newRate * 0.25;
+	// envelopes step every stepSamples; everything updateParams drives runs
+	// once per controlPeriod sub-blocks, so at that fraction of the voice rate
+	const auto envRate = newRate / Envelope::stepSamples;
+	const auto controlRate = newRate / controlPeriod;
+	maxFreq = std::min(20000.f, static_cast<float>(newRate * 0.45));
 	osc1.setSampleRate(newRate);
 	osc2.setSampleRate(newRate);
 	osc3.setSampleRate(newRate);
 	osc4.setSampleRate(newRate);
 
 	filter.setSampleRate(newRate);
-	noteSmoother.setSampleRate(quarter);
+	noteSmoother.setSampleRate(controlRate);
 
-	lfo1.setSampleRate(quarter);
-	lfo2.setSampleRate(quarter);
-	lfo3.setSampleRate(quarter);
-	lfo4.setSampleRate(quarter);
+	lfo1.setSampleRate(controlRate);
+	lfo2.setSampleRate(controlRate);
+	lfo3.setSampleRate(controlRate);
+	lfo4.setSampleRate(controlRate);
 
-	env1.setSampleRate(quarter);
-	env2.setSampleRate(quarter);
-	env3.setSampleRate(quarter);
-	env4.setSampleRate(quarter);
+	env1.setSampleRate(envRate);
+	env2.setSampleRate(envRate);
+	env3.setSampleRate(envRate);
+	env4.setSampleRate(envRate);
 
 	constexpr Envelope::Params p;
 	env1.setParameters(p);
@@ -208,12 +224,12 @@ void SynthVoice3::setCurrentSampleRate(double newRate)
 	env3.setParameters(p);
 	env4.setParameters(p);
 
-	mseg1.setSampleRate(quarter);
-	mseg2.setSampleRate(quarter);
-	mseg3.setSampleRate(quarter);
-	mseg4.setSampleRate(quarter);
+	mseg1.setSampleRate(controlRate);
+	mseg2.setSampleRate(controlRate);
+	mseg3.setSampleRate(controlRate);
+	mseg4.setSampleRate(controlRate);
 
-	fnb1 = std::exp(-2.0 * pi * 3500 / quarter);
+	fnb1 = std::exp(-2.0 * pi * 3500 / controlRate);
 	fna0 = 1 - fnb1;
 	fnz1 = 95; // proc.filterParams.frequency->getUserValue();
 	fqb1 = fnb1;
@@ -221,113 +237,236 @@ void SynthVoice3::setCurrentSampleRate(double newRate)
 	fqz1 = 0; // proc.filterParams.resonance->getUserValue();
 }
 
+void SynthVoice3::setScratch(float *left, float *right)
+{
+	scratchChannels[0] = left;
+	scratchChannels[1] = right;
+}
+
 void SynthVoice3::renderNextBlock(juce::AudioBuffer<float> &outputBuffer, int startSample, int numSamples)
 {
+	prepareBlock(numSamples);
+	renderOrbits(numSamples);
+	filterBlock(false);
+	finishVoiceBlock(outputBuffer, startSample, numSamples);
+}
+
+void SynthVoice3::prepareBlock(int numSamples)
+{
+	jassert(numSamples <= maxBlockSamples);
 	updateParams(numSamples);
 
-	synthBuffer.setSize(2, numSamples, false, false, true);
+	jassert(scratchChannels[0] != nullptr);
+	synthBuffer.setDataToReferTo(scratchChannels, 2, numSamples);
+
+	// envelopes and antipop run at a quarter of the oversampled rate, so each
+	// step covers 4 samples; the envelopes ramp across them for whoever renders us
+	static_assert(Envelope::stepSamples == 4);
+	const int numSteps = (numSamples + 3) / 4;
+	float envPeaks[4], peaks[4];
+	for (int e = 0; e < 4; e++)
+		envPeaks[e] = envsByNum[static_cast<size_t>(e)]->renderBlock(envBlocks[e], numSteps);
+	for (int k = 0; k < 4; k++) {
+		// envs[0] ~= env1!, etc., assigned in updateParams
+		const auto e = static_cast<size_t>(std::find(envsByNum.begin(), envsByNum.end(), envs[static_cast<size_t>(k)]) - envsByNum.begin());
+		envLevels[k] = envBlocks[e];
+		peaks[k] = envPeaks[e];
+	}
+
+	for (int i = 0; i < numSteps; i++) {
+		std::fill_n(antipopLevels + i * 4, 4, antipop);
+		antipop += .03f;
+		antipop = std::min(antipop, 1.0f);
+	}
+
+	// a wide kernel reads whole registers; hold the last levels out to the end of one
+	constexpr int lanes = mipp::N<float>();
+	const int padded = ((numSamples + lanes - 1) / lanes) * lanes;
+	for (int j = numSteps * 4; j < padded; j++) {
+		for (int e = 0; e < 4; e++)
+			envBlocks[e][j] = envBlocks[e][j - 1];
+		antipopLevels[j] = antipopLevels[j - 1];
+	}
+
+	// A planet with no volume, or whose envelope sits at 0 for the whole block,
+	// adds nothing to its epicycle: skip its oscillator (keeping the phase
+	// moving) and let the kernel ride straight on the planet below.
+	APOscillator *oscs[4] = {&osc1, &osc2, &osc3, &osc4};
+	const APOscillator::Settings *settings[4] = {&osc1Params, &osc2Params, &osc3Params, &osc4Params};
+	const float freqs[4] = {osc1Freq, osc2Freq, osc3Freq, osc4Freq};
+	float *xs[4] = {osc1xs, osc2xs, osc3xs, osc4xs};
+	float *ys[4] = {osc1ys, osc2ys, osc3ys, osc4ys};
+
+	liveMask = 0;
+	for (int k = 0; k < 4; k++) {
+		if (std::abs(settings[k]->vol) > 0.f && peaks[k] > 0.f) {
+			// fill arrays with quadrature samples
+			oscs[k]->renderFloats(freqs[k], *settings[k], xs[k], ys[k], numSamples);
+			oscZeroed[k] = false;
+			liveMask |= 1 << k;
+		} else {
+			oscs[k]->advance(freqs[k], numSamples);
+			if (!oscZeroed[k]) {  // a VoiceBank still reads them
+				std::fill_n(xs[k], maxBlockSamples, 0.f);
+				std::fill_n(ys[k], maxBlockSamples, 0.f);
+				oscZeroed[k] = true;
+			}
+		}
+	}
+}
+
+template <int... Ids>
+constexpr std::array<SynthVoice3::OrbitKernel, sizeof...(Ids)> SynthVoice3::makeOrbitKernels(std::integer_sequence<int, Ids...>)
+{
+	return {&SynthVoice3::renderOrbitsFor<Ids / 16, Ids % 16>...};
+}
+
+void SynthVoice3::renderOrbits(int numSamples)
+{
+	// one kernel per algorithm and combination of live planets
+	static constexpr auto kernels = makeOrbitKernels(std::make_integer_sequence<int, 4 * 16>{});
+	(this->*kernels[static_cast<size_t>(juce::jlimit(0, 3, algo) * 16 + liveMask)])(numSamples);
+}
+
+// Each algorithm gets its own copy of the kernel, with the planets it doesn't
+// mix into the output (and their distances) compiled out:
+//   algo 0: 1 > 2 > 3 > 4, hear 4
+//   algo 1: 1 > 2 > 3, 2 > 4, hear 3 and 4
+//   algo 2: 1 > 2, 1 > 3 > 4, hear 2 and 4
+//   algo 3: 1 > 2, 1 > 3, 1 > 4, hear 2, 3 and 4
+// Live has a bit per planet whose oscillator was rendered this block; the rest
+// are silent and just pass the epicycle below them along.
+template <int Algo, int Live>
+void SynthVoice3::renderOrbitsFor(int numSamples)
+{
+	static_assert(Algo >= 0 && Algo < 4 && Live >= 0 && Live < 16);
+	constexpr bool live1 = Live & 1, live2 = Live & 2, live3 = Live & 4, live4 = Live & 8;
+	constexpr bool hear2 = Algo == 2 || Algo == 3;
+	constexpr bool hear3 = Algo == 1 || Algo == 3;
+	constexpr float recip = Algo == 0 ? 1.f : (Algo == 3 ? 1.f / 3.f : .5f);
+
 	const auto synthBufferL = synthBuffer.getWritePointer(0);
 	const auto synthBufferR = synthBuffer.getWritePointer(1);
 
-	// fill arrays with quadrature samples
-	osc1.renderFloats(osc1Freq, osc1Params, osc1xs, osc1ys, numSamples);
-	osc2.renderFloats(osc2Freq, osc2Params, osc2xs, osc2ys, numSamples);
-	osc3.renderFloats(osc3Freq, osc3Params, osc3xs, osc3ys, numSamples);
-	osc4.renderFloats(osc4Freq, osc4Params, osc4xs, osc4ys, numSamples);
+	const mipp::Reg<float> eq = equant, one = 1.f, tiny = .000001f;
+	const float dmScale = demodVol * recip;
+	const float mixA = FastMath<float>::minimaxSin(demodMix * pi_v<float> * 0.5f);
+	const float mixB = FastMath<float>::minimaxSin((demodMix - 1.0f) * pi_v<float> * 0.5f);
+
+	// however many samples fit in a register: 4 for SSE/NEON, 8 for AVX2, 16 for AVX-512
+	constexpr int lanes = mipp::N<float>();
 
 	// the whole enchilada
-	for (int i = 0; i < std::ceil((static_cast<float>(numSamples)) / 4.f);i++) 
-	{
-		a = envs[0]->getOutput();  // assigned in updateParams
-		b = envs[1]->getOutput();  // envs[0] ~= env1!, etc.
-		c = envs[2]->getOutput();
-		d = envs[3]->getOutput();
-
-		env1.getNextSample();
-		env2.getNextSample();
-		env3.getNextSample();
-		env4.getNextSample();
-
-		osc1x.load(&osc1xs[i * 4]);  // vectors of samples
-		osc1y.load(&osc1ys[i * 4]);
-		osc2x.load(&osc2xs[i * 4]);
-		osc2y.load(&osc2ys[i * 4]);
-		osc3x.load(&osc3xs[i * 4]);
-		osc3y.load(&osc3ys[i * 4]);
-		osc4x.load(&osc4xs[i * 4]);
-		osc4y.load(&osc4ys[i * 4]);
-
-		epi1xs[i] = osc1x * a;  // apply env
-		epi1ys[i] = osc1y * a;
-
-		epi2xs[i] = mipp::fmadd(osc2x, b, epi1xs[i]);  // 2 always based on 1
-		epi2ys[i] = mipp::fmadd(osc2y, b, epi1ys[i]);
-
-		// save distance/inverse for modulated sample, where we only care about angle
-		dist2sq = mipp::fmadd((epi2ys[i] - equant), (epi2ys[i] - equant), (epi2xs[i] * epi2xs[i]));
-		dist2 = mipp::sqrt(dist2sq);
-		invDist2 = oneFloat / (dist2 + .000001f);
-
-		// look ma, no branch
-		epi3xs[i] = mipp::fmadd(osc3x, c, epi2xs[i] * bits3[algo][0] + epi1xs[i] * bits3[algo][1]);
-		epi3ys[i] = mipp::fmadd(osc3y, c, epi2ys[i] * bits3[algo][0] + epi1ys[i] * bits3[algo][1]);
-		epi4xs[i] = mipp::fmadd(osc4x, d, epi3xs[i] * bits4[algo][0] + epi2xs[i] * bits4[algo][1] + epi1xs[i] * bits4[algo][2]);
-		epi4ys[i] = mipp::fmadd(osc4y, d, epi3ys[i] * bits4[algo][0] + epi2ys[i] * bits4[algo][1] + epi1ys[i] * bits4[algo][2]);
-
-		dist3sq = mipp::fmadd((epi3ys[i] - equant), (epi3ys[i] - equant), (epi3xs[i] * epi3xs[i]));
-		dist3 = mipp::sqrt(dist3sq);
-		invDist3 = oneFloat / (dist3 + .000001f);
-		dist4sq = mipp::fmadd((epi4ys[i] - equant), (epi4ys[i] - equant), (epi4xs[i] * epi4xs[i]));
-		dist4 = mipp::sqrt(dist4sq);
-		invDist4 = oneFloat / (dist4 + .000001f);
+	for (int n = 0; n < numSamples; n += lanes) {
+		const mipp::Reg<float> a(&envLevels[0][n]);  // per sample, so wider registers
+		const mipp::Reg<float> b(&envLevels[1][n]);  // can straddle envelope steps
+		const mipp::Reg<float> c(&envLevels[2][n]);
+		const mipp::Reg<float> d(&envLevels[3][n]);
+
+		// apply envs; 2 always based on 1
+		mipp::Reg<float> epi1x = 0.f, epi1y = 0.f;
+		if constexpr (live1) {
+			epi1x = mipp::Reg<float>(&osc1xs[n]) * a;
+			epi1y = mipp::Reg<float>(&osc1ys[n]) * a;
+		}
+		auto epi2x = epi1x, epi2y = epi1y;
+		if constexpr (live2) {
+			epi2x = mipp::fmadd(mipp::Reg<float>(&osc2xs[n]), b, epi1x);
+			epi2y = mipp::fmadd(mipp::Reg<float>(&osc2ys[n]), b, epi1y);
+		}
+
+		auto epi3x = Algo < 2 ? epi2x : epi1x;
+		auto epi3y = Algo < 2 ? epi2y : epi1y;
+		if constexpr (live3) {
+			epi3x = mipp::fmadd(mipp::Reg<float>(&osc3xs[n]), c, epi3x);
+			epi3y = mipp::fmadd(mipp::Reg<float>(&osc3ys[n]), c, epi3y);
+		}
+
+		auto epi4x = Algo == 0 || Algo == 2 ? epi3x : (Algo == 1 ? epi2x : epi1x);
+		auto epi4y = Algo == 0 || Algo == 2 ? epi3y : (Algo == 1 ? epi2y : epi1y);
+		if constexpr (live4) {
+			epi4x = mipp::fmadd(mipp::Reg<float>(&osc4xs[n]), d, epi4x);
+			epi4y = mipp::fmadd(mipp::Reg<float>(&osc4ys[n]), d, epi4y);
+		}
 
 		// get sine/cosine directly, without calculating angle, apply envelopes
-		auto s4 = epi4ys[i] - (d * equant); // let envelope help tame equant
-		auto s3 = epi3ys[i] - (c * equant);
-		auto s2 = epi2ys[i] - (b * equant);
-
-		sine4 = s4 * invDist4 * d;
-		cos4 = epi4xs[i] * invDist4 * d;
-		sine3 = s3 * invDist3 * c;
-		cos3 = epi3xs[i] * invDist3 * c;
-		sine2 = s2 * invDist2 * b;
-		cos2 = epi2xs[i] * invDist2 * b;
-
-		dmCos4 = s4 * dist4;
-		dmSine4 = epi4xs[i] * dist4;
-		dmCos3 = s3 * dist3;
-		dmSine3 = epi3xs[i] * dist3;
-		dmCos2 = s2 * dist2;
-		dmSine2 = epi2xs[i] * dist2;
-
-		sampleL = mix(
-			(sine4 * mb[algo][0] + sine3 * mb[algo][1] + sine2 * mb[algo][2]) * mb[algo][3],
-			(dmSine4 * mb[algo][0] + dmSine3 * mb[algo][1] + dmSine2 * mb[algo][2]) * (demodVol * mb[algo][3]),
-			demodMix
-		);
-		sampleR = mix(
-			(cos4 * mb[algo][0] + cos3 * mb[algo][1] + cos2 * mb[algo][2]) * mb[algo][3],
-			(dmCos4 * mb[algo][0] + dmCos3 * mb[algo][1] + dmCos2 * mb[algo][2]) * (demodVol * mb[algo][3]),
-			demodMix
-		);
-
-		sampleL = mipp::sat(sampleL, -1.0f, 1.0f) * antipop; // sat's doing some work!
-		sampleR = mipp::sat(sampleR, -1.0f, 1.0f) * antipop;
-
-		antipop += .03f;
-		antipop = std::min(antipop, 1.0f);
+		const auto s4 = epi4y - (d * eq);  // let envelope help tame equant
+		const auto dist4 = mipp::sqrt(mipp::fmadd(epi4y - eq, epi4y - eq, epi4x * epi4x));
+		const auto invDist4 = one / (dist4 + tiny);
+		auto sines = s4 * invDist4 * d;
+		auto coses = epi4x * invDist4 * d;
+		auto dmSines = epi4x * dist4;
+		auto dmCoses = s4 * dist4;
+
+		if constexpr (hear3) {
+			const auto s3 = epi3y - (c * eq);
+			const auto dist3 = mipp::sqrt(mipp::fmadd(epi3y - eq, epi3y - eq, epi3x * epi3x));
+			const auto invDist3 = one / (dist3 + tiny);
+			sines += s3 * invDist3 * c;
+			coses += epi3x * invDist3 * c;
+			dmSines += epi3x * dist3;
+			dmCoses += s3 * dist3;
+		}
+		if constexpr (hear2) {
+			const auto s2 = epi2y - (b * eq);
+			const auto dist2 = mipp::sqrt(mipp::fmadd(epi2y - eq, epi2y - eq, epi2x * epi2x));
+			const auto invDist2 = one / (dist2 + tiny);
+			sines += s2 * invDist2 * b;
+			coses += epi2x * invDist2 * b;
+			dmSines += epi2x * dist2;
+			dmCoses += s2 * dist2;
+		}
+
+		auto sampleL = mipp::fmadd(sines * recip, mixA, dmSines * dmScale * mixB);
+		auto sampleR = mipp::fmadd(coses * recip, mixA, dmCoses * dmScale * mixB);
+
+		const mipp::Reg<float> antipopReg(&antipopLevels[n]);
+		sampleL = mipp::sat(sampleL, -1.0f, 1.0f) * antipopReg; // sat's doing some work!
+		sampleR = mipp::sat(sampleR, -1.0f, 1.0f) * antipopReg;
 
 		// SHIP IT OUT
-		sampleL.store(&synthBufferL[i * mipp::N<float>()]);
-		sampleR.store(&synthBufferR[i * mipp::N<float>()]);
+		if (n + lanes <= numSamples) {
+			sampleL.store(&synthBufferL[n]);
+			sampleR.store(&synthBufferR[n]);
+		} else {  // ragged end of a sub-block: don't write past synthBuffer
+			sampleL.store(tailL);
+			sampleR.store(tailR);
+			std::copy_n(tailL, numSamples - n, &synthBufferL[n]);
+			std::copy_n(tailR, numSamples - n, &synthBufferR[n]);
+		}
 	}
+}
 
-	// Get and apply velocity according to keytrack param
+float SynthVoice3::voiceGain()
+{
+	// velocity according to keytrack param
 	const float velocity = currentlyPlayingNote.noteOnVelocity.asUnsignedFloat();
-	const float ampKeyTrack = getValue(proc.globalParams.velSens);
-	synthBuffer.applyGain(gin::velocityToGain(velocity, ampKeyTrack) * baseAmplitude);
-	filter.process(synthBuffer);
+	const float ampKeyTrack = paramValue(proc.globalParams.velSens);
+	return gin::velocityToGain(velocity, ampKeyTrack) * baseAmplitude;
+}
+
+void SynthVoice3::filterBlock(const bool filteredInBank)
+{
+	if (!filteredInBank) {
+		synthBuffer.applyGain(voiceGain());
+		switch (proc.voiceFilterMode) {
+			case FilterMode::perVoice:
+				filter.process(synthBuffer);
+				break;
+			case FilterMode::svfBank:
+				svf.process(svfCoeffs, synthBuffer.getArrayOfWritePointers(), synthBuffer.getNumSamples());
+				break;
+			case FilterMode::shared:
+				break;
+		}
+	}
+
+	const int numSamples = synthBuffer.getNumSamples();
+	blockPeak = std::max(synthBuffer.getMagnitude(0, 0, numSamples), synthBuffer.getMagnitude(1, 0, numSamples));
+}
 
+void SynthVoice3::finishVoiceBlock(juce::AudioBuffer<float> &outputBuffer, int startSample, int numSamples)
+{
 	// Add synth voice to output
 	outputBuffer.addFrom(0, startSample, synthBuffer, 0, 0, numSamples);
 	outputBuffer.addFrom(1, startSample, synthBuffer, 1, 0, numSamples);
@@ -352,6 +491,22 @@ void SynthVoice3::renderNextBlock(juce::AudioBuffer<float> &outputBuffer, int st
 			break;
 	}
 
+	// A released note can ring on far below hearing while its envelopes
+	// take their time (or never get to idle): once the output has stayed
+	// under the threshold for the hold time, let the voice go.
+	if (!voiceShouldStop && isPlayingButReleased()) {
+		if (blockPeak < proc.globalParams.silenceThreshold->getProcValue()) {
+			silentSamples += numSamples;
+			const auto holdSamples = proc.globalParams.silenceHold->getUserValue() * 0.001 * getSampleRate();
+			if (silentSamples >= holdSamples) {
+				voiceShouldStop = true;
+				proc.voicesRetiredBySilence.fetch_add(1, std::memory_order_relaxed);
+			}
+		} else {
+			silentSamples = 0;
+		}
+	}
+
 	if (voiceShouldStop) {
 		clearCurrentNote();
 		stopVoice();
@@ -359,25 +514,19 @@ void SynthVoice3::renderNextBlock(juce::AudioBuffer<float> &outputBuffer, int st
 
 }
 
-mipp::Reg<float> SynthVoice3::mix(const mipp::Reg<float>& aReg, const mipp::Reg<float>& bReg, const float mix) {
-	const mipp::Reg<float> mixa = FastMath<float>::minimaxSin(mix * pi_v<float> * 0.5f);
-	const mipp::Reg<float> mixb = FastMath<float>::minimaxSin((mix - 1.0f) * pi_v<float> * 0.5f);
-	return mipp::fmadd(aReg, mixa, (bReg * mixb));
-}
-
 void SynthVoice3::updateParams(int blockSize)
 {
 	if (tilUpdate != 0) {
 		--tilUpdate;
 		return;
-	}  // at 4x os, we don't need this every block
+	}  // control objects run at 1/controlPeriod of the voice rate, whatever the oversampling
 	else {
-		tilUpdate = 3;
-	}  // every 4th to match envelope/lfo/mseg
-	algo = static_cast<int>(getValue(proc.timbreParams.algo));
-	equant = getValue(proc.timbreParams.equant);
-	demodVol = getValue(proc.timbreParams.demodvol);
-	demodMix = getValue(proc.timbreParams.demodmix);
+		tilUpdate = controlPeriod - 1;
+	}  // every controlPeriod-th block to match lfo/mseg
+	algo = static_cast<int>(paramValue(proc.timbreParams.algo));
+	equant = paramValue(proc.timbreParams.equant);
+	demodVol = paramValue(proc.timbreParams.demodvol);
+	demodMix = paramValue(proc.timbreParams.demodmix);
 
 	auto note = getCurrentlyPlayingNote();
 	proc.modMatrix.setPolyValue(
@@ -389,55 +538,54 @@ void SynthVoice3::updateParams(int blockSize)
 
 	float dummy;
 	float remainder = std::modf(currentMidiNote, &dummy);
-	auto baseFreq = static_cast<float>(MTS_NoteToFrequency(
-	    proc.client, static_cast<char>(currentMidiNote), static_cast<char>(note.midiChannel)));
-	baseFreq *= static_cast<float>(
-		std::pow(1.05946309436f, note.totalPitchbendInSemitones 
-		* (proc.globalParams.pitchbendRange->getUserValue() / 2.0f) 
-		+ remainder));
-	baseFreq = juce::jlimit(20.0f, 20000.f, baseFreq * getValue(proc.timbreParams.pitch));
+	auto baseFreq = proc.tuning.get(static_cast<int>(currentMidiNote), note.midiChannel);
+	baseFreq *= FastMath<float>::fastExp2((note.totalPitchbendInSemitones
+		* (proc.globalParams.pitchbendRange->getUserValue() / 2.0f)
+		+ remainder) * (1.f / 12.f));
+	baseFreq = juce::jlimit(20.0f, 20000.f, baseFreq * paramValue(proc.timbreParams.pitch));
 
 	if (proc.osc1Params.fixed->isOn()) {
 		osc1Freq = std::clamp(
-		    (static_cast<int>(getValue(proc.osc1Params.coarse) + 0.0001f)
-			+ getValue(proc.osc1Params.fine)) * 100.f, 0.01f, 20000.f);
+		    (static_cast<int>(paramValue(proc.osc1Params.coarse) + 0.0001f)
+			+ paramValue(proc.osc1Params.fine)) * 100.f, 0.01f, 20000.f);
 	} else {
 		osc1Freq = baseFreq
-			* (static_cast<int>(getValue(proc.osc1Params.coarse) + 0.0001f)
-			+ getValue(proc.osc1Params.fine));
+			* (static_cast<int>(paramValue(proc.osc1Params.coarse) + 0.0001f)
+			+ paramValue(proc.osc1Params.fine));
 	}
 	if (proc.osc2Params.fixed->isOn()) {
 		osc2Freq = std::clamp(
-		    (static_cast<int>(getValue(proc.osc2Params.coarse) + 0.0001f) 
-			+ getValue(proc.osc2Params.fine)) * 100.f, 0.01f, 20000.f);
+		    (static_cast<int>(paramValue(proc.osc2Params.coarse) + 0.0001f) 
+			+ paramValue(proc.osc2Params.fine)) * 100.f, 0.01f, 20000.f);
 	} else {
 		osc2Freq = baseFreq 
-			* (static_cast<int>(getValue(proc.osc2Params.coarse) + 0.0001f)
-		    + getValue(proc.osc2Params.fine));
+			* (static_cast<int>(paramValue(proc.osc2Params.coarse) + 0.0001f)
+		    + paramValue(proc.osc2Params.fine));
 	}
 	if (proc.osc3Params.fixed->isOn()) {
 		osc3Freq = std::clamp(
-		    (static_cast<int>(getValue(proc.osc3Params.coarse) + 0.0001f)
-			+ getValue(proc.osc3Params.fine)) * 100.f, 0.01f, 20000.f);
+		    (static_cast<int>(paramValue(proc.osc3Params.coarse) + 0.0001f)
+			+ paramValue(proc.osc3Params.fine)) * 100.f, 0.01f, 20000.f);
 	} else {
 		osc3Freq = baseFreq 
-			* (static_cast<int>(getValue(proc.osc3Params.coarse) + 0.0001f) 
-			+ getValue(proc.osc3Params.fine));
+			* (static_cast<int>(paramValue(proc.osc3Params.coarse) + 0.0001f) 
+			+ paramValue(proc.osc3Params.fine));
 	}
 	if (proc.osc4Params.fixed->isOn()) {
 		osc4Freq = std::clamp(
-		    (static_cast<int>(getValue(proc.osc4Params.coarse) + 0.0001f) 
-			+ getValue(proc.osc4Params.fine)) 
+		    (static_cast<int>(paramValue(proc.osc4Params.coarse) + 0.0001f) 
+			+ paramValue(proc.osc4Params.fine)) 
 			* 100.f, 0.01f, 20000.f);
 	} else {
 		osc4Freq = baseFreq 
-			* (static_cast<int>(getValue(proc.osc4Params.coarse) + 0.0001f)
-			+ getValue(proc.osc4Params.fine));
+			* (static_cast<int>(paramValue(proc.osc4Params.coarse) + 0.0001f)
+			+ paramValue(proc.osc4Params.fine));
 	}
 
-	osc1Params.wave = waveForChoice(static_cast<int>(getValue(proc.osc1Params.wave)));
-	osc1Params.vol = getValue(proc.osc1Params.volume);
-	auto phaseParam = getValue(proc.osc1Params.phase);
+	osc1Params.wave = waveForChoice(static_cast<int>(paramValue(proc.osc1Params.wave)));
+	osc1Params.analytic = osc1Params.wave == gin::Wave::sine;
+	osc1Params.vol = paramValue(proc.osc1Params.volume);
+	auto phaseParam = paramValue(proc.osc1Params.phase);
 	auto diff = phaseParam - lastp1;
 	osc1.bumpPhase(diff);
 	lastp1 = phaseParam;
@@ -446,9 +594,10 @@ void SynthVoice3::updateParams(int blockSize)
 	// osc 2
 	//==================================================
 
-	osc2Params.wave = waveForChoice(static_cast<int>(getValue(proc.osc2Params.wave)));
-	osc2Params.vol = getValue(proc.osc2Params.volume);
-	phaseParam = getValue(proc.osc2Params.phase);
+	osc2Params.wave = waveForChoice(static_cast<int>(paramValue(proc.osc2Params.wave)));
+	osc2Params.analytic = osc2Params.wave == gin::Wave::sine;
+	osc2Params.vol = paramValue(proc.osc2Params.volume);
+	phaseParam = paramValue(proc.osc2Params.phase);
 	diff = phaseParam - lastp2;
 	osc2.bumpPhase(diff);
 	lastp2 = phaseParam;
@@ -457,9 +606,10 @@ void SynthVoice3::updateParams(int blockSize)
 	// osc 3
 	// ------------------
 
-	osc3Params.wave = waveForChoice(static_cast<int>(getValue(proc.osc3Params.wave)));
-	osc3Params.vol = getValue(proc.osc3Params.volume);
-	phaseParam = getValue(proc.osc3Params.phase);
+	osc3Params.wave = waveForChoice(static_cast<int>(paramValue(proc.osc3Params.wave)));
+	osc3Params.analytic = osc3Params.wave == gin::Wave::sine;
+	osc3Params.vol = paramValue(proc.osc3Params.volume);
+	phaseParam = paramValue(proc.osc3Params.phase);
 	diff = phaseParam - lastp3;
 	osc3.bumpPhase(diff);
 	lastp3 = phaseParam;
@@ -467,61 +617,36 @@ void SynthVoice3::updateParams(int blockSize)
 
 	// osc4
 	// -------------
-	osc4Params.wave = waveForChoice(static_cast<int>(getValue(proc.osc4Params.wave)));
-	osc4Params.vol = getValue(proc.osc4Params.volume);
-	phaseParam = getValue(proc.osc4Params.phase);
+	osc4Params.wave = waveForChoice(static_cast<int>(paramValue(proc.osc4Params.wave)));
+	osc4Params.analytic = osc4Params.wave == gin::Wave::sine;
+	osc4Params.vol = paramValue(proc.osc4Params.volume);
+	phaseParam = paramValue(proc.osc4Params.phase);
 	diff = phaseParam - lastp4;
 	osc4.bumpPhase(diff);
 	lastp4 = phaseParam;
 	envs[3] = envsByNum[static_cast<size_t>(proc.osc4Params.env->getUserValueInt())];
 	
-	switch (proc.filterParams.type->getUserValueInt())
-	{
-		case 0:
-			filter.setType(gin::Filter::lowpass);
-			filter.setSlope(gin::Filter::db12);
-			break;
-		case 1:
-			filter.setType(gin::Filter::lowpass);
-			filter.setSlope(gin::Filter::db24);
-			break;
-		case 2:
-			filter.setType(gin::Filter::highpass);
-			filter.setSlope(gin::Filter::db12);
-			break;
-		case 3:
-			filter.setType(gin::Filter::highpass);
-			filter.setSlope(gin::Filter::db24);
-			break;
-		case 4:
-			filter.setType(gin::Filter::bandpass);
-			filter.setSlope(gin::Filter::db12);
-			break;
-		case 5:
-			filter.setType(gin::Filter::bandpass);
-			filter.setSlope(gin::Filter::db24);
-			break;
-		case 6:
-			filter.setType(gin::Filter::notch);
-			filter.setSlope(gin::Filter::db12);
-			break;
-		case 7:
-			filter.setType(gin::Filter::notch);
-			filter.setSlope(gin::Filter::db24);
-			break;
-	}
-
 // filter
-	float noteNum = getValue(proc.filterParams.frequency);
+	float noteNum = paramValue(proc.filterParams.frequency);
 	noteNum += (currentlyPlayingNote.initialNote - 50) *
-	           getValue(proc.filterParams.keyTracking);
-	float f = gin::getMidiNoteInHertz(noteNum);
-	f = juce::jlimit(4.0f, maxFreq, f);
-	float q = gin::Q / (1.0f - (getValue(proc.filterParams.resonance) / 100.0f) * 0.99f);
+	           paramValue(proc.filterParams.keyTracking);
+	float q = gin::Q / (1.0f - (paramValue(proc.filterParams.resonance) / 100.0f) * 0.99f);
 
 	fnz1 = fna0 * noteNum + fnb1 * fnz1;
 	fqz1 = fqa0 * q + fqb1 * fqz1;
-	filter.setParams(juce::jlimit<float>(4.f, maxFreq, gin::getMidiNoteInHertz(fnz1)), fqz1);
+	cutoff = juce::jlimit<float>(4.f, maxFreq, FastMath<float>::noteToHz(fnz1));
+	switch (proc.voiceFilterMode) {
+		case FilterMode::perVoice:
+			setFilterType(filter, proc.filterParams.type->getUserValueInt());
+			filter.setParams(cutoff, fqz1);
+			break;
+		case FilterMode::svfBank:
+			svfCoeffs = VoiceSVF::makeCoeffs(proc.filterParams.type->getUserValueInt(), cutoff,
+				static_cast<float>(fqz1), getSampleRate());
+			break;
+		case FilterMode::shared:
+			break;  // APAudioProcessor filters the sum
+	}
 
 	gin::LFO::Parameters params;
 	float freq = 0;
@@ -529,16 +654,16 @@ void SynthVoice3::updateParams(int blockSize)
 	// lfo 1
 	if (proc.lfo1Params.sync->getUserValue() > 0.0f)
 		freq = 1.f / gin::NoteDuration::getNoteDurations()
-		    [static_cast<size_t>(proc.lfo1Params.beat->getUserValue())].toSeconds(proc.playhead);
+		    [static_cast<size_t>(proc.lfo1Params.beat->getUserValue())].toSeconds(&proc.blockPlayHead);
 	else
-		freq = getValue(proc.lfo1Params.rate);
+		freq = paramValue(proc.lfo1Params.rate);
 	params.waveShape = static_cast<gin::LFO::WaveShape>(proc.lfo1Params.wave->getUserValueInt());
 	params.frequency = freq;
-	params.phase = getValue(proc.lfo1Params.phase);
-	params.offset = getValue(proc.lfo1Params.offset);
-	params.depth = getValue(proc.lfo1Params.depth);
-	params.delay = getValue(proc.lfo1Params.delay);
-	params.fade = getValue(proc.lfo1Params.fade);
+	params.phase = paramValue(proc.lfo1Params.phase);
+	params.offset = paramValue(proc.lfo1Params.offset);
+	params.depth = paramValue(proc.lfo1Params.depth);
+	params.delay = paramValue(proc.lfo1Params.delay);
+	params.fade = paramValue(proc.lfo1Params.fade);
 	lfo1.setParameters(params);
 	lfo1.process(blockSize);
 	proc.modMatrix.setPolyValue(*this, proc.modSrcLFO1, lfo1.getOutput());
@@ -546,16 +671,16 @@ void SynthVoice3::updateParams(int blockSize)
 	// lfo 2
 	if (proc.lfo2Params.sync->getUserValue() > 0.0f)
 		freq = 1.f / gin::NoteDuration::getNoteDurations()
-			[static_cast<size_t>(proc.lfo2Params.beat->getUserValue())].toSeconds(proc.playhead);
+			[static_cast<size_t>(proc.lfo2Params.beat->getUserValue())].toSeconds(&proc.blockPlayHead);
 	else
-		freq = getValue(proc.lfo2Params.rate);
+		freq = paramValue(proc.lfo2Params.rate);
 	params.waveShape = static_cast<gin::LFO::WaveShape>(proc.lfo2Params.wave->getUserValueInt());
 	params.frequency = freq;
-	params.phase = getValue(proc.lfo2Params.phase);
-	params.offset = getValue(proc.lfo2Params.offset);
-	params.depth = getValue(proc.lfo2Params.depth);
-	params.delay = getValue(proc.lfo2Params.delay);
-	params.fade = getValue(proc.lfo2Params.fade);
+	params.phase = paramValue(proc.lfo2Params.phase);
+	params.offset = paramValue(proc.lfo2Params.offset);
+	params.depth = paramValue(proc.lfo2Params.depth);
+	params.delay = paramValue(proc.lfo2Params.delay);
+	params.fade = paramValue(proc.lfo2Params.fade);
 	lfo2.setParameters(params);
 	lfo2.process(blockSize);
 	proc.modMatrix.setPolyValue(*this, proc.modSrcLFO2, lfo2.getOutput());
@@ -563,16 +688,16 @@ void SynthVoice3::updateParams(int blockSize)
 	// lfo 3
 	if (proc.lfo3Params.sync->getUserValue() > 0.0f)
 		freq = 1.f / gin::NoteDuration::getNoteDurations()
-		    [static_cast<size_t>(proc.lfo3Params.beat->getUserValue())].toSeconds(proc.playhead);
+		    [static_cast<size_t>(proc.lfo3Params.beat->getUserValue())].toSeconds(&proc.blockPlayHead);
 	else
-		freq = getValue(proc.lfo3Params.rate);
+		freq = paramValue(proc.lfo3Params.rate);
 	params.waveShape = static_cast<gin::LFO::WaveShape>(proc.lfo3Params.wave->getUserValueInt());
 	params.frequency = freq;
-	params.phase = getValue(proc.lfo3Params.phase);
-	params.offset = getValue(proc.lfo3Params.offset);
-	params.depth = getValue(proc.lfo3Params.depth);
-	params.delay = getValue(proc.lfo3Params.delay);
-	params.fade = getValue(proc.lfo3Params.fade);
+	params.phase = paramValue(proc.lfo3Params.phase);
+	params.offset = paramValue(proc.lfo3Params.offset);
+	params.depth = paramValue(proc.lfo3Params.depth);
+	params.delay = paramValue(proc.lfo3Params.delay);
+	params.fade = paramValue(proc.lfo3Params.fade);
 	lfo3.setParameters(params);
 	lfo3.process(blockSize);
 	proc.modMatrix.setPolyValue(*this, proc.modSrcLFO3, lfo3.getOutput());
@@ -580,47 +705,47 @@ void SynthVoice3::updateParams(int blockSize)
 	// lfo 4
 	if (proc.lfo4Params.sync->getUserValue() > 0.0f)
 		freq = 1.f / gin::NoteDuration::getNoteDurations()
-			[static_cast<size_t>(proc.lfo4Params.beat->getUserValue())].toSeconds(proc.playhead);
+			[static_cast<size_t>(proc.lfo4Params.beat->getUserValue())].toSeconds(&proc.blockPlayHead);
 	else
-		freq = getValue(proc.lfo4Params.rate);
+		freq = paramValue(proc.lfo4Params.rate);
 	params.waveShape = static_cast<gin::LFO::WaveShape>(proc.lfo4Params.wave->getUserValueInt());
 	params.frequency = freq;
-	params.phase = getValue(proc.lfo4Params.phase);
-	params.offset = getValue(proc.lfo4Params.offset);
-	params.depth = getValue(proc.lfo4Params.depth);
-	params.delay = getValue(proc.lfo4Params.delay);
-	params.fade = getValue(proc.lfo4Params.fade);
+	params.phase = paramValue(proc.lfo4Params.phase);
+	params.offset = paramValue(proc.lfo4Params.offset);
+	params.depth = paramValue(proc.lfo4Params.depth);
+	params.delay = paramValue(proc.lfo4Params.delay);
+	params.fade = paramValue(proc.lfo4Params.fade);
 	lfo4.setParameters(params);
 	lfo4.process(blockSize);
 	proc.modMatrix.setPolyValue(*this, proc.modSrcLFO4, lfo4.getOutput());
 
 	Envelope::Params p;
-	p.attackTimeMs = getValue(proc.env1Params.attack);
-	p.decayTimeMs = getValue(proc.env1Params.decay);
-	p.sustainLevel = getValue(proc.env1Params.sustain);
-	p.releaseTimeMs = fastKill ? 0.01f : getValue(proc.env1Params.release);
-	p.aCurve = getValue(proc.env1Params.acurve);
-	p.dRCurve = getValue(proc.env1Params.drcurve);
+	p.attackTimeMs = paramValue(proc.env1Params.attack);
+	p.decayTimeMs = paramValue(proc.env1Params.decay);
+	p.sustainLevel = paramValue(proc.env1Params.sustain);
+	p.releaseTimeMs = fastKill ? 0.01f : paramValue(proc.env1Params.release);
+	p.aCurve = paramValue(proc.env1Params.acurve);
+	p.dRCurve = paramValue(proc.env1Params.drcurve);
 	int mode = proc.env1Params.syncrepeat->getUserValueInt();
 	p.sync = (mode != 0);
 	p.repeat = (mode != 0);
 	if (mode == 1) {
 		p.sync = true;
 		p.syncduration = 1.f * gin::NoteDuration::getNoteDurations()
-		    [static_cast<size_t>(proc.env1Params.duration->getUserValue())].toSeconds(proc.playhead);
+		    [static_cast<size_t>(proc.env1Params.duration->getUserValue())].toSeconds(&proc.blockPlayHead);
 	}
 	if (mode == 2) {
 		p.sync = true;
-		p.syncduration = getValue(proc.env1Params.time);
+		p.syncduration = paramValue(proc.env1Params.time);
 	}
 	env1.setParameters(p);
 
-	p.attackTimeMs = getValue(proc.env2Params.attack);
-	p.decayTimeMs = getValue(proc.env2Params.decay);
-	p.sustainLevel = getValue(proc.env2Params.sustain);
-	p.releaseTimeMs = fastKill ? 0.01f : getValue(proc.env2Params.release);
-	p.aCurve = getValue(proc.env2Params.acurve);
-	p.dRCurve = getValue(proc.env2Params.drcurve);
+	p.attackTimeMs = paramValue(proc.env2Params.attack);
+	p.decayTimeMs = paramValue(proc.env2Params.decay);
+	p.sustainLevel = paramValue(proc.env2Params.sustain);
+	p.releaseTimeMs = fastKill ? 0.01f : paramValue(proc.env2Params.release);
+	p.aCurve = paramValue(proc.env2Params.acurve);
+	p.dRCurve = paramValue(proc.env2Params.drcurve);
 	mode = proc.env2Params.syncrepeat->getUserValueInt();
 	p.sync = (mode != 0);
 	p.repeat = (mode != 0);
@@ -628,51 +753,51 @@ void SynthVoice3::updateParams(int blockSize)
 		p.sync = true;
 		p.syncduration =
 		    1.f * gin::NoteDuration::getNoteDurations()
-			[static_cast<size_t>(proc.env2Params.duration->getUserValue())].toSeconds(proc.playhead);
+			[static_cast<size_t>(proc.env2Params.duration->getUserValue())].toSeconds(&proc.blockPlayHead);
 	}
 	if (mode == 2) {
 		p.sync = true;
-		p.syncduration = getValue(proc.env2Params.time);
+		p.syncduration = paramValue(proc.env2Params.time);
 	}
 	env2.setParameters(p);
 
-	p.attackTimeMs = getValue(proc.env3Params.attack);
-	p.decayTimeMs = getValue(proc.env3Params.decay);
-	p.sustainLevel = getValue(proc.env3Params.sustain);
-	p.releaseTimeMs = fastKill ? 0.01f : getValue(proc.env3Params.release);
-	p.aCurve = getValue(proc.env3Params.acurve);
-	p.dRCurve = getValue(proc.env3Params.drcurve);
+	p.attackTimeMs = paramValue(proc.env3Params.attack);
+	p.decayTimeMs = paramValue(proc.env3Params.decay);
+	p.sustainLevel = paramValue(proc.env3Params.sustain);
+	p.releaseTimeMs = fastKill ? 0.01f : paramValue(proc.env3Params.release);
+	p.aCurve = paramValue(proc.env3Params.acurve);
+	p.dRCurve = paramValue(proc.env3Params.drcurve);
 	mode = proc.env3Params.syncrepeat->getUserValueInt();
 	p.sync = (mode != 0);
 	p.repeat = (mode != 0);
 	if (mode == 1) {
 		p.sync = true;
 		p.syncduration = 1.f * gin::NoteDuration::getNoteDurations()
-		    [static_cast<size_t>(proc.env3Params.duration->getUserValue())].toSeconds(proc.playhead);
+		    [static_cast<size_t>(proc.env3Params.duration->getUserValue())].toSeconds(&proc.blockPlayHead);
 	}
 	if (mode == 2) {
 		p.sync = true;
-		p.syncduration = getValue(proc.env3Params.time);
+		p.syncduration = paramValue(proc.env3Params.time);
 	}
 	env3.setParameters(p);
 
-	p.attackTimeMs = getValue(proc.env4Params.attack);
-	p.decayTimeMs = getValue(proc.env4Params.decay);
-	p.sustainLevel = getValue(proc.env4Params.sustain);
-	p.releaseTimeMs = fastKill ? 0.01f : getValue(proc.env4Params.release);
-	p.aCurve = getValue(proc.env4Params.acurve);
-	p.dRCurve = getValue(proc.env4Params.drcurve);
+	p.attackTimeMs = paramValue(proc.env4Params.attack);
+	p.decayTimeMs = paramValue(proc.env4Params.decay);
+	p.sustainLevel = paramValue(proc.env4Params.sustain);
+	p.releaseTimeMs = fastKill ? 0.01f : paramValue(proc.env4Params.release);
+	p.aCurve = paramValue(proc.env4Params.acurve);
+	p.dRCurve = paramValue(proc.env4Params.drcurve);
 	mode = proc.env4Params.syncrepeat->getUserValueInt();
 	p.sync = (mode != 0);
 	p.repeat = (mode != 0);
 	if (mode == 1) {
 		p.sync = true;
 		p.syncduration = 1.f * gin::NoteDuration::getNoteDurations()
-		    [static_cast<size_t>(proc.env4Params.duration->getUserValue())].toSeconds(proc.playhead);
+		    [static_cast<size_t>(proc.env4Params.duration->getUserValue())].toSeconds(&proc.blockPlayHead);
 	}
 	if (mode == 2) {
 		p.sync = true;
-		p.syncduration = getValue(proc.env4Params.time);
+		p.syncduration = paramValue(proc.env4Params.time);
 	}
 	env4.setParameters(p);
 
@@ -684,42 +809,42 @@ void SynthVoice3::updateParams(int blockSize)
 	// MSEGs
 	if (proc.mseg1Params.sync->isOn()) {
 		mseg1Params.frequency = 1.f / gin::NoteDuration::getNoteDurations()
-			[static_cast<size_t>(getValue(proc.mseg1Params.beat))].toSeconds(proc.playhead);
+			[static_cast<size_t>(paramValue(proc.mseg1Params.beat))].toSeconds(&proc.blockPlayHead);
 	} else {
-		mseg1Params.frequency = getValue(proc.mseg1Params.rate);
+		mseg1Params.frequency = paramValue(proc.mseg1Params.rate);
 	}
-	mseg1Params.depth = getValue(proc.mseg1Params.depth);  // proc.mseg1Params.depth->getUserValue();
-	mseg1Params.offset = getValue(proc.mseg1Params.offset);
+	mseg1Params.depth = paramValue(proc.mseg1Params.depth);  // proc.mseg1Params.depth->getUserValue();
+	mseg1Params.offset = paramValue(proc.mseg1Params.offset);
 	mseg1Params.loop = proc.mseg1Params.loop->isOn();
 
 	if (proc.mseg2Params.sync->isOn()) {
 		mseg2Params.frequency = 1.f / gin::NoteDuration::getNoteDurations()
-			[static_cast<size_t>(getValue(proc.mseg2Params.beat))].toSeconds(proc.playhead);
+			[static_cast<size_t>(paramValue(proc.mseg2Params.beat))].toSeconds(&proc.blockPlayHead);
 	} else {
-		mseg2Params.frequency = getValue(proc.mseg2Params.rate);
+		mseg2Params.frequency = paramValue(proc.mseg2Params.rate);
 	}
-	mseg2Params.depth = getValue(proc.mseg2Params.depth);
-	mseg2Params.offset = getValue(proc.mseg2Params.offset);
+	mseg2Params.depth = paramValue(proc.mseg2Params.depth);
+	mseg2Params.offset = paramValue(proc.mseg2Params.offset);
 	mseg2Params.loop = proc.mseg2Params.loop->isOn();
 
 	if (proc.mseg3Params.sync->isOn()) {
 		mseg3Params.frequency = 1.f / gin::NoteDuration::getNoteDurations()
-			[static_cast<size_t>(getValue(proc.mseg3Params.beat))].toSeconds(proc.playhead);
+			[static_cast<size_t>(paramValue(proc.mseg3Params.beat))].toSeconds(&proc.blockPlayHead);
 	} else {
-		mseg3Params.frequency = getValue(proc.mseg3Params.rate);
+		mseg3Params.frequency = paramValue(proc.mseg3Params.rate);
 	}
-	mseg3Params.depth = getValue(proc.mseg3Params.depth);  // proc.mseg3Params.depth->getUserValue();
-	mseg3Params.offset = getValue(proc.mseg3Params.offset);
+	mseg3Params.depth = paramValue(proc.mseg3Params.depth);  // proc.mseg3Params.depth->getUserValue();
+	mseg3Params.offset = paramValue(proc.mseg3Params.offset);
 	mseg3Params.loop = proc.mseg3Params.loop->isOn();
 
 	if (proc.mseg4Params.sync->isOn()) {
 		mseg4Params.frequency = 1.f / gin::NoteDuration::getNoteDurations()
-			[static_cast<size_t>(getValue(proc.mseg4Params.beat))].toSeconds(proc.playhead);
+			[static_cast<size_t>(paramValue(proc.mseg4Params.beat))].toSeconds(&proc.blockPlayHead);
 	} else {
-		mseg4Params.frequency = getValue(proc.mseg4Params.rate);
+		mseg4Params.frequency = paramValue(proc.mseg4Params.rate);
 	}
-	mseg4Params.depth = getValue(proc.mseg4Params.depth);
-	mseg4Params.offset = getValue(proc.mseg4Params.offset);
+	mseg4Params.depth = paramValue(proc.mseg4Params.depth);
+	mseg4Params.offset = paramValue(proc.mseg4Params.offset);
 	mseg4Params.loop = proc.mseg4Params.loop->isOn();
 
 	mseg1.setParameters(mseg1Params);
@@ -738,12 +863,56 @@ void SynthVoice3::updateParams(int blockSize)
 	proc.modMatrix.setPolyValue(*this, proc.modSrcMSEG4, mseg4.getOutput());
 }
 
+float SynthVoice3::paramValue(gin::Parameter *p)
+{
+	return proc.paramSnapshot.isPolyModulated(p) ? getValue(p) : proc.paramSnapshot.get(p);
+}
+
 float SynthVoice3::getFilterCutoffNormalized() const {
-	const float freq = filter.getFrequency();
+	const float freq = proc.voiceFilterMode == FilterMode::shared ? proc.sharedFilter.getFrequency() : cutoff;
 	const auto range = proc.filterParams.frequency->getUserRange();
 	return range.convertTo0to1(juce::jlimit(range.start, range.end, gin::getMidiNoteFromHertz(freq)));
 }
 
+void SynthVoice3::setFilterType(gin::Filter &f, const int type)
+{
+	switch (type)
+	{
+		case 0:
+			f.setType(gin::Filter::lowpass);
+			f.setSlope(gin::Filter::db12);
+			break;
+		case 1:
+			f.setType(gin::Filter::lowpass);
+			f.setSlope(gin::Filter::db24);
+			break;
+		case 2:
+			f.setType(gin::Filter::highpass);
+			f.setSlope(gin::Filter::db12);
+			break;
+		case 3:
+			f.setType(gin::Filter::highpass);
+			f.setSlope(gin::Filter::db24);
+			break;
+		case 4:
+			f.setType(gin::Filter::bandpass);
+			f.setSlope(gin::Filter::db12);
+			break;
+		case 5:
+			f.setType(gin::Filter::bandpass);
+			f.setSlope(gin::Filter::db24);
+			break;
+		case 6:
+			f.setType(gin::Filter::notch);
+			f.setSlope(gin::Filter::db12);
+			break;
+		case 7:
+			f.setType(gin::Filter::notch);
+			f.setSlope(gin::Filter::db24);
+			break;
+	}
+}
+
 gin::Wave SynthVoice3::waveForChoice(const int choice)
 {
 	switch (choice) {
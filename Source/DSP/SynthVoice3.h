@@ -17,11 +17,14 @@
 #include <gin_dsp/gin_dsp.h>
 #include <gin_plugin/gin_plugin.h>
 #include <juce_audio_basics/juce_audio_basics.h>
+#include <array>
 #include <numbers>
 #include <random>
+#include <utility>
 #include "Envelope.h"
 #include "MTS-ESP/libMTSClient.h"
 #include "Oscillator.h"
+#include "VoiceSVF.h"
 class APAudioProcessor;
 
 using std::numbers::pi_v;
@@ -41,13 +44,13 @@ public:
 	void noteKeyStateChanged() override {}
 
 	void setCurrentSampleRate(double newRate) override;
+	// sub-blocks between control updates: 4 live, 1 for offline renders
+	void setControlPeriod(int subBlocks);
 
 	void renderNextBlock(juce::AudioBuffer<float> &outputBuffer,
 	    int startSample,
 	    int numSamples) override;
 
-	mipp::Reg<float> mix(const mipp::Reg<float>& aReg, const mipp::Reg<float>& bReg, const float mix);
-
 	float getCurrentNote() override
 	{
 		return noteSmoother.getCurrentValue() * 127.0f;
@@ -72,12 +75,43 @@ public:
 	
 	gin::Wave waveForChoice(const int choice);
 
+	// where a voice's filter runs: its own gin::Filter at 4x, one filter on
+	// the summed output at 1x (only when every voice would agree on it), or
+	// an SVF that a VoiceBank runs across its lanes
+	enum class FilterMode { perVoice, shared, svfBank };
+	static void setFilterType(gin::Filter &f, int type);
+
+	// the largest sub-block we get asked for: one mini block at 4x
+	static constexpr int maxBlockSamples = 128;
+
+	// where synthBuffer lives: maxBlockSamples per channel, from the
+	// processor's ScratchArena
+	void setScratch(float *left, float *right);
+
 private:
 	void updateParams(int blockSize);
 
+	// the block's shared value, unless a poly source makes it differ per voice
+	float paramValue(gin::Parameter *p);
+
+	// renderNextBlock, split up so APSynth can hand the middle part to a
+	// VoiceBank, and everything but finishVoiceBlock to a render thread
+	void prepareBlock(int numSamples);
+	void renderOrbits(int numSamples);
+	template <int Algo, int Live> void renderOrbitsFor(int numSamples);
+	using OrbitKernel = void (SynthVoice3::*)(int);
+	template <int... Ids>
+	static constexpr std::array<OrbitKernel, sizeof...(Ids)> makeOrbitKernels(std::integer_sequence<int, Ids...>);
+	[[nodiscard]] float voiceGain();
+	void filterBlock(bool filteredInBank);
+	void finishVoiceBlock(juce::AudioBuffer<float> &outputBuffer, int startSample, int numSamples);
+
 	APAudioProcessor &proc;
 
 	gin::Filter filter;
+	VoiceSVF svf;
+	VoiceSVF::Coeffs svfCoeffs;
+	float cutoff{20000.f};  // Hz, whichever filter is in use
 	gin::LFO lfo1, lfo2, lfo3, lfo4;
 	gin::MSEG mseg1, mseg2, mseg3, mseg4;
 	APOscillator osc1, osc2, osc3, osc4;
@@ -90,34 +124,30 @@ private:
 
 	int filterType{0};
 
-	float osc1xs[128]{0.f};  // at 4x sr, processed down to 32
-	float osc1ys[128]{0.f};  // direct output from oscillators
-	float osc2xs[128]{0.f};
-	float osc2ys[128]{0.f};
-	float osc3xs[128]{0.f};
-	float osc3ys[128]{0.f};
-	float osc4xs[128]{0.f};
-	float osc4ys[128]{0.f};
-
-	// the same, as registers
-	mipp::Reg<float> osc1x, osc1y, osc2x, osc2y, osc3x, osc3y, osc4x, osc4y;
-
-	// interpreted positions, added together according to algo
-	mipp::Reg<float> epi1xs[32]{0.f};
-	mipp::Reg<float> epi1ys[32]{0.f};
-	mipp::Reg<float> epi2xs[32]{0.f};
-	mipp::Reg<float> epi2ys[32]{0.f};
-	mipp::Reg<float> epi3xs[32]{0.f};
-	mipp::Reg<float> epi3ys[32]{0.f};
-	mipp::Reg<float> epi4xs[32]{0.f};
-	mipp::Reg<float> epi4ys[32]{0.f};
-
-	int tilUpdate{0};  // only update envelopes/lfo/mseg every 4th block
-
-	// distances and inverse distances
-	mipp::Reg<float> dist2sq, dist2, invDist2;
-	mipp::Reg<float> dist3sq, dist3, invDist3;
-	mipp::Reg<float> dist4sq, dist4, invDist4;
+	alignas(64) float osc1xs[128]{0.f};  // at 4x sr, processed down to 32
+	alignas(64) float osc1ys[128]{0.f};  // direct output from oscillators
+	alignas(64) float osc2xs[128]{0.f};
+	alignas(64) float osc2ys[128]{0.f};
+	alignas(64) float osc3xs[128]{0.f};
+	alignas(64) float osc3ys[128]{0.f};
+	alignas(64) float osc4xs[128]{0.f};
+	alignas(64) float osc4ys[128]{0.f};
+
+	// envelope levels and antipop ramp, one per oversampled sample
+	// (padded to whole registers by prepareBlock); envBlocks is by envelope
+	// number, envLevels by planet, as planets can share an envelope
+	alignas(64) float envBlocks[4][maxBlockSamples]{};
+	const float *envLevels[4]{envBlocks[0], envBlocks[1], envBlocks[2], envBlocks[3]};
+	alignas(64) float antipopLevels[maxBlockSamples]{};
+
+	int liveMask{0xF};  // planets rendered this block, bit 0 = planet 1
+	bool oscZeroed[4]{};  // a skipped planet's arrays only need clearing once
+
+	int tilUpdate{0};  // only update lfo/mseg/params every controlPeriod-th block
+	int controlPeriod{4};
+
+	float blockPeak{0.f};  // of the filtered voice output, set by filterBlock
+	int silentSamples{0};  // since note-off, below the silence threshold
 
 	float currentMidiNote = -1;
 	APOscillator::Settings osc1Params, osc2Params, osc3Params, osc4Params;
@@ -133,23 +163,12 @@ private:
 	double fna0, fnb1, fnz1, fqa0, fqb1, fqz1;
 
 	juce::AudioBuffer<float> synthBuffer;
+	float *scratchChannels[2]{};
 
-	mipp::Reg<float> sine2{0.f, 0.f, 0.f, 0.f}, cos2{0.f, 0.f, 0.f, 0.f},
-	    sine3{0.f, 0.f, 0.f, 0.f}, cos3{0.f, 0.f, 0.f, 0.f},
-	    sine4{0.f, 0.f, 0.f, 0.f}, cos4{0.f, 0.f, 0.f, 0.f};
-
-	mipp::Reg<float> dmSine2{0.f, 0.f, 0.f, 0.f}, dmSine3{0.f, 0.f, 0.f, 0.f},
-        dmSine4{0.f,0.f, 0.f, 0.f};
-    mipp::Reg<float> dmCos2{0.f, 0.f, 0.f, 0.f}, dmCos3{0.f, 0.f, 0.f, 0.f}, dmCos4{0.f, 0.f, 0.f, 0.f};
-	// redundant??
-	mipp::Reg<float> sample2L, sample2R, sample3L, sample3R, sample4L, sample4R;
-
-	mipp::Reg<float> sampleL{0.f, 0.f, 0.f, 0.f}, sampleR{0.f, 0.f, 0.f, 0.f};
+	alignas(64) float tailL[mipp::N<float>()]{}, tailR[mipp::N<float>()]{};  // last partial register
 
 	float demodMix{0.f}, demodVol{0.f};
 	float antipop{0.f};
-	mipp::Reg<float> oneFloat{ 1.f, 1.f, 1.f, 1.f };
-	mipp::Reg<float> a, b, c, d;
 	float bits3[4][2] = { {1, 0}, {1, 0}, {0, 1}, {0, 1} }; // epi2, epi1
 	float bits4[4][3] = { {1, 0, 0}, {0, 1, 0}, {1, 0, 0}, {0, 0, 1} }; // epi3, epi2, epi1
 	float mb[4][4] = { // mixBits --> sine4, 3, 2, and mix reciprocal
@@ -157,10 +176,11 @@ private:
 	};
 
 	friend class APSynth;
+	friend class VoiceBank;
 	juce::MPENote curNote;
 
 	std::random_device rd;
 	std::mt19937 gen{rd()};
 	std::uniform_real_distribution<> dist{-1.f, 1.f};
-	const float maxFreq{20000.f};
+	float maxFreq{20000.f};  // kept clear of Nyquist at low oversampling
 };
@@ -0,0 +1,56 @@
+/*
+ * Audible Planets - an expressive, quasi-Ptolemaic semi-modular synthesizer
+ *
+ * Copyright 2024, Greg Recco
+ *
+ * Audible Planets is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * All source for Audible Planets is available at
+ * https://github.com/gregrecco67/AudiblePlanets
+ */
+
+#include "TuningTable.h"
+
+bool TuningTable::readRow(MTSClient *client, const int row)
+{
+	// the client is asked with the same channel number the voices used to pass
+	bool changed = false;
+	auto &r = freqs[static_cast<size_t>(row)];
+	for (int n = 0; n < numNotes; n++) {
+		const auto f = static_cast<float>(MTS_NoteToFrequency(client, static_cast<char>(n), static_cast<char>(row + 1)));
+		changed |= f < r[static_cast<size_t>(n)] || f > r[static_cast<size_t>(n)];
+		r[static_cast<size_t>(n)] = f;
+	}
+	return changed;
+}
+
+void TuningTable::rebuild(MTSClient *client)
+{
+	for (int row = 0; row < numChannels; row++)
+		readRow(client, row);
+	built = true;
+}
+
+void TuningTable::update(MTSClient *client)
+{
+	const bool hasMaster = MTS_HasMaster(client);
+	if (!built || hasMaster != hadMaster) {
+		hadMaster = hasMaster;
+		rebuild(client);
+		return;
+	}
+	if (!hasMaster)
+		return;
+
+	// channel 1 every block: a master retuning all channels at once, the
+	// usual case, lands on the next block. Per-channel retunes are caught
+	// by the other rows in turn, within numChannels - 1 blocks
+	const int row = nextRow;
+	nextRow = nextRow % (numChannels - 1) + 1;
+	const bool changed = readRow(client, 0);
+	if (readRow(client, row) || changed)
+		rebuild(client);
+}
@@ -0,0 +1,49 @@
+/*
+ * Audible Planets - an expressive, quasi-Ptolemaic semi-modular synthesizer
+ *
+ * Copyright 2024, Greg Recco
+ *
+ * Audible Planets is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * All source for Audible Planets is available at
+ * https://github.com/gregrecco67/AudiblePlanets
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include "MTS-ESP/libMTSClient.h"
+
+//==============================================================================
+// Note frequencies for every MIDI note on every channel, read from MTS-ESP in
+// bulk so a voice's pitch is a lookup rather than a call into the client.
+// With no master connected the table only changes when tuning sysex arrives;
+// with one, channel 1's row and one other are re-read each block and any
+// difference re-reads the lot.
+class TuningTable {
+public:
+	static constexpr int numNotes = 128, numChannels = 16;
+
+	// once per block, before the voices update
+	void update(MTSClient *client);
+
+	// after tuning sysex has been handed to the client
+	void rebuild(MTSClient *client);
+
+	// channel as JUCE numbers it, 1-16
+	[[nodiscard]] float get(const int note, const int channel) const noexcept
+	{
+		return freqs[static_cast<size_t>((channel - 1) & (numChannels - 1))][static_cast<size_t>(note & (numNotes - 1))];
+	}
+
+private:
+	bool readRow(MTSClient *client, int row);
+
+	std::array<std::array<float, numNotes>, numChannels> freqs{};
+	bool built{false}, hadMaster{false};
+	int nextRow{1};  // cycles through channels 2-16
+};
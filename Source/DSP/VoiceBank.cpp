@@ -0,0 +1,264 @@
+/*
+ * Audible Planets - an expressive, quasi-Ptolemaic semi-modular synthesizer
+ *
+ * Copyright 2024, Greg Recco
+ *
+ * Audible Planets is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * All source for Audible Planets is available at
+ * https://github.com/gregrecco67/AudiblePlanets
+ */
+
+#include "PluginProcessor.h"
+#include "VoiceBank.h"
+
+void VoiceBank::render(SynthVoice3 *const *group, const int numVoices, const int numSamples, const bool filter)
+{
+	jassert(numVoices > 0 && numVoices <= lanes);
+	jassert(numSamples <= maxSamples);
+
+	gather(group, numVoices, numSamples);
+
+	// a group that agrees on its algorithm gets the specialised kernel
+	int algo = juce::jlimit(0, 3, group[0]->algo);
+	for (int l = 1; l < numVoices; l++) {
+		if (group[l]->algo != algo) {
+			algo = -1;
+			break;
+		}
+	}
+
+	switch (algo) {
+		case 0: kernel<0>(numSamples); break;
+		case 1: kernel<1>(numSamples); break;
+		case 2: kernel<2>(numSamples); break;
+		case 3: kernel<3>(numSamples); break;
+		default: kernel<-1>(numSamples); break;
+	}
+
+	if (filter)
+		filterLanes(group, numVoices, numSamples);
+
+	scatter(group, numVoices, numSamples);
+}
+
+// Same maths as SynthVoice3::renderOrbitsFor, across voices instead of
+// samples. Algo -1 is a group of mixed algorithms, which falls back on
+// per-lane weights.
+template <int Algo>
+void VoiceBank::kernel(const int numSamples)
+{
+	constexpr bool mixed = Algo < 0;
+	constexpr bool hear2 = mixed || Algo == 2 || Algo == 3;
+	constexpr bool hear3 = mixed || Algo == 1 || Algo == 3;
+
+	const mipp::Reg<float> w3a(w3[0]), w3b(w3[1]);
+	const mipp::Reg<float> w4a(w4[0]), w4b(w4[1]), w4c(w4[2]);
+	const mipp::Reg<float> mb4(mixBits[0]), mb3(mixBits[1]), mb2(mixBits[2]);
+	const mipp::Reg<float> rcp(recip), dmScale(demodScale);
+	const mipp::Reg<float> eq(equants), ma(mixA), mbb(mixB);
+	const mipp::Reg<float> one(1.f), tiny(.000001f);
+
+	for (int j = 0; j < numSamples; j++) {
+		const int o = j * lanes;
+
+		const mipp::Reg<float> a(&envs[0][o]);
+		const mipp::Reg<float> b(&envs[1][o]);
+		const mipp::Reg<float> c(&envs[2][o]);
+		const mipp::Reg<float> d(&envs[3][o]);
+
+		const auto epi1x = mipp::Reg<float>(&oscXs[0][o]) * a;
+		const auto epi1y = mipp::Reg<float>(&oscYs[0][o]) * a;
+		const auto epi2x = mipp::fmadd(mipp::Reg<float>(&oscXs[1][o]), b, epi1x);
+		const auto epi2y = mipp::fmadd(mipp::Reg<float>(&oscYs[1][o]), b, epi1y);
+
+		mipp::Reg<float> epi3x, epi3y, epi4x, epi4y;
+		if constexpr (mixed) {
+			epi3x = mipp::fmadd(mipp::Reg<float>(&oscXs[2][o]), c, epi2x * w3a + epi1x * w3b);
+			epi3y = mipp::fmadd(mipp::Reg<float>(&oscYs[2][o]), c, epi2y * w3a + epi1y * w3b);
+			epi4x = mipp::fmadd(mipp::Reg<float>(&oscXs[3][o]), d, epi3x * w4a + epi2x * w4b + epi1x * w4c);
+			epi4y = mipp::fmadd(mipp::Reg<float>(&oscYs[3][o]), d, epi3y * w4a + epi2y * w4b + epi1y * w4c);
+		} else {
+			epi3x = mipp::fmadd(mipp::Reg<float>(&oscXs[2][o]), c, Algo < 2 ? epi2x : epi1x);
+			epi3y = mipp::fmadd(mipp::Reg<float>(&oscYs[2][o]), c, Algo < 2 ? epi2y : epi1y);
+			epi4x = mipp::fmadd(mipp::Reg<float>(&oscXs[3][o]), d,
+				Algo == 0 || Algo == 2 ? epi3x : (Algo == 1 ? epi2x : epi1x));
+			epi4y = mipp::fmadd(mipp::Reg<float>(&oscYs[3][o]), d,
+				Algo == 0 || Algo == 2 ? epi3y : (Algo == 1 ? epi2y : epi1y));
+		}
+
+		const auto s4 = epi4y - d * eq;
+		const auto dist4 = mipp::sqrt(mipp::fmadd(epi4y - eq, epi4y - eq, epi4x * epi4x));
+		const auto invDist4 = one / (dist4 + tiny);
+		auto sines = s4 * invDist4 * d;
+		auto coses = epi4x * invDist4 * d;
+		auto dmSines = epi4x * dist4;
+		auto dmCoses = s4 * dist4;
+		if constexpr (mixed) {
+			sines *= mb4;
+			coses *= mb4;
+			dmSines *= mb4;
+			dmCoses *= mb4;
+		}
+
+		if constexpr (hear3) {
+			const auto s3 = epi3y - c * eq;
+			const auto dist3 = mipp::sqrt(mipp::fmadd(epi3y - eq, epi3y - eq, epi3x * epi3x));
+			const auto invDist3 = one / (dist3 + tiny);
+			if constexpr (mixed) {
+				sines += s3 * invDist3 * c * mb3;
+				coses += epi3x * invDist3 * c * mb3;
+				dmSines += epi3x * dist3 * mb3;
+				dmCoses += s3 * dist3 * mb3;
+			} else {
+				sines += s3 * invDist3 * c;
+				coses += epi3x * invDist3 * c;
+				dmSines += epi3x * dist3;
+				dmCoses += s3 * dist3;
+			}
+		}
+		if constexpr (hear2) {
+			const auto s2 = epi2y - b * eq;
+			const auto dist2 = mipp::sqrt(mipp::fmadd(epi2y - eq, epi2y - eq, epi2x * epi2x));
+			const auto invDist2 = one / (dist2 + tiny);
+			if constexpr (mixed) {
+				sines += s2 * invDist2 * b * mb2;
+				coses += epi2x * invDist2 * b * mb2;
+				dmSines += epi2x * dist2 * mb2;
+				dmCoses += s2 * dist2 * mb2;
+			} else {
+				sines += s2 * invDist2 * b;
+				coses += epi2x * invDist2 * b;
+				dmSines += epi2x * dist2;
+				dmCoses += s2 * dist2;
+			}
+		}
+
+		const mipp::Reg<float> antipop(&antipops[o]);
+		const auto sampleL = mipp::sat(mipp::fmadd(sines * rcp, ma, dmSines * dmScale * mbb), -1.0f, 1.0f) * antipop;
+		const auto sampleR = mipp::sat(mipp::fmadd(coses * rcp, ma, dmCoses * dmScale * mbb), -1.0f, 1.0f) * antipop;
+
+		sampleL.store(&outL[o]);
+		sampleR.store(&outR[o]);
+	}
+}
+
+void VoiceBank::gather(SynthVoice3 *const *group, const int numVoices, const int numSamples)
+{
+	for (int l = 0; l < lanes; l++) {
+		if (l >= numVoices) {
+			// an empty lane: zero envelopes keep everything downstream at 0
+			for (int j = 0; j < numSamples; j++) {
+				const int o = j * lanes + l;
+				for (int k = 0; k < 4; k++) {
+					oscXs[k][o] = 0.f;
+					oscYs[k][o] = 0.f;
+					envs[k][o] = 0.f;
+				}
+				antipops[o] = 0.f;
+			}
+			w3[0][l] = w3[1][l] = 0.f;
+			w4[0][l] = w4[1][l] = w4[2][l] = 0.f;
+			mixBits[0][l] = mixBits[1][l] = mixBits[2][l] = 0.f;
+			recip[l] = demodScale[l] = equants[l] = mixA[l] = mixB[l] = 0.f;
+			continue;
+		}
+
+		const SynthVoice3 &v = *group[l];
+		const float *xs[4] = {v.osc1xs, v.osc2xs, v.osc3xs, v.osc4xs};
+		const float *ys[4] = {v.osc1ys, v.osc2ys, v.osc3ys, v.osc4ys};
+
+		for (int j = 0; j < numSamples; j++) {
+			const int o = j * lanes + l;
+			for (int k = 0; k < 4; k++) {
+				oscXs[k][o] = xs[k][j];
+				oscYs[k][o] = ys[k][j];
+				envs[k][o] = v.envLevels[k][j];
+			}
+			antipops[o] = v.antipopLevels[j];
+		}
+
+		const int algo = v.algo;
+		w3[0][l] = v.bits3[algo][0];
+		w3[1][l] = v.bits3[algo][1];
+		w4[0][l] = v.bits4[algo][0];
+		w4[1][l] = v.bits4[algo][1];
+		w4[2][l] = v.bits4[algo][2];
+		mixBits[0][l] = v.mb[algo][0];
+		mixBits[1][l] = v.mb[algo][1];
+		mixBits[2][l] = v.mb[algo][2];
+		recip[l] = v.mb[algo][3];
+		demodScale[l] = v.demodVol * v.mb[algo][3];
+		equants[l] = v.equant;
+		mixA[l] = FastMath<float>::minimaxSin(v.demodMix * pi_v<float> * 0.5f);
+		mixB[l] = FastMath<float>::minimaxSin((v.demodMix - 1.0f) * pi_v<float> * 0.5f);
+	}
+}
+
+// Each voice's gain and VoiceSVF, one voice per lane, straight on the
+// kernel's output. The state goes back to the voices afterwards, so a voice
+// can drop out of the bank next block and carry on with the scalar SVF.
+void VoiceBank::filterLanes(SynthVoice3 *const *group, const int numVoices, const int numSamples)
+{
+	int stages = 1;
+	for (int l = 0; l < lanes; l++) {
+		const bool used = l < numVoices;
+		const VoiceSVF::Coeffs c = used ? group[l]->svfCoeffs : VoiceSVF::Coeffs{};
+		gains[l] = used ? group[l]->voiceGain() : 0.f;
+		svfA[0][l] = c.a1;
+		svfA[1][l] = c.a2;
+		svfA[2][l] = c.a3;
+		for (int s = 0; s < 2; s++) {
+			svfM[s][0][l] = c.m0[s];
+			svfM[s][1][l] = c.m1[s];
+			svfM[s][2][l] = c.m2[s];
+			for (int ch = 0; ch < 2; ch++) {
+				svfIc1[s][ch][l] = used ? group[l]->svf.ic1[s][ch] : 0.f;
+				svfIc2[s][ch][l] = used ? group[l]->svf.ic2[s][ch] : 0.f;
+			}
+		}
+		stages = std::max(stages, c.stages);
+	}
+
+	const mipp::Reg<float> gain(gains), a1(svfA[0]), a2(svfA[1]), a3(svfA[2]);
+	float *outs[2] = {outL, outR};
+	for (int ch = 0; ch < 2; ch++) {
+		for (int s = 0; s < stages; s++) {
+			const mipp::Reg<float> m0(svfM[s][0]), m1(svfM[s][1]), m2(svfM[s][2]);
+			mipp::Reg<float> ic1(svfIc1[s][ch]), ic2(svfIc2[s][ch]);
+			for (int j = 0; j < numSamples; j++) {
+				float *o = outs[ch] + j * lanes;
+				auto x = mipp::Reg<float>(o);
+				if (s == 0)
+					x *= gain;
+				VoiceSVF::tick(x, ic1, ic2, a1, a2, a3, m0, m1, m2).store(o);
+			}
+			ic1.store(svfIc1[s][ch]);
+			ic2.store(svfIc2[s][ch]);
+		}
+	}
+
+	for (int l = 0; l < numVoices; l++) {
+		for (int s = 0; s < 2; s++) {
+			for (int ch = 0; ch < 2; ch++) {
+				group[l]->svf.ic1[s][ch] = svfIc1[s][ch][l];
+				group[l]->svf.ic2[s][ch] = svfIc2[s][ch][l];
+			}
+		}
+	}
+}
+
+void VoiceBank::scatter(SynthVoice3 *const *group, const int numVoices, const int numSamples)
+{
+	for (int l = 0; l < numVoices; l++) {
+		auto *left = group[l]->synthBuffer.getWritePointer(0);
+		auto *right = group[l]->synthBuffer.getWritePointer(1);
+		for (int j = 0; j < numSamples; j++) {
+			left[j] = outL[j * lanes + l];
+			right[j] = outR[j * lanes + l];
+		}
+	}
+}
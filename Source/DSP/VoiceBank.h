@@ -0,0 +1,74 @@
+/*
+ * Audible Planets - an expressive, quasi-Ptolemaic semi-modular synthesizer
+ *
+ * Copyright 2024, Greg Recco
+ *
+ * Audible Planets is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * All source for Audible Planets is available at
+ * https://github.com/gregrecco67/AudiblePlanets
+ */
+
+#pragma once
+
+#include <gin_dsp/gin_dsp.h>
+#include "SynthVoice3.h"
+
+//==============================================================================
+// Runs the epicycle/equant kernel for several voices at once, one voice per
+// SIMD lane. Voices still do their own control-rate work (prepareBlock) and
+// post-processing (filterBlock, finishVoiceBlock); the bank only replaces
+// renderOrbits.
+// Orbital state is kept as structure-of-arrays: for every sample, the values
+// of all lanes sit next to each other, so one register load picks up the
+// same quantity for every voice in the group.
+class VoiceBank {
+public:
+	static constexpr int lanes = mipp::N<float>();
+	static constexpr int maxSamples = SynthVoice3::maxBlockSamples;
+
+	// Smallest group worth banking, and only in svfBank mode: without the
+	// filter, the orbit kernel is already vectorised across samples and the
+	// transpose in and out of the bank costs more than it saves. With 8 lanes
+	// or more the bank is off altogether. Check with "APBenchmarks voicebank".
+	static constexpr int minVoices = lanes <= 4 ? 2 : lanes + 1;
+
+	// render up to `lanes` prepared voices into their synthBuffers; with
+	// filter set, also apply each voice's gain and SVF on the way out
+	void render(SynthVoice3 *const *group, int numVoices, int numSamples, bool filter = false);
+
+private:
+	template <int Algo> void kernel(int numSamples);
+	void gather(SynthVoice3 *const *group, int numVoices, int numSamples);
+	void scatter(SynthVoice3 *const *group, int numVoices, int numSamples);
+	void filterLanes(SynthVoice3 *const *group, int numVoices, int numSamples);
+
+	// per sample, per lane
+	alignas(64) float oscXs[4][maxSamples * lanes]{};
+	alignas(64) float oscYs[4][maxSamples * lanes]{};
+	alignas(64) float envs[4][maxSamples * lanes]{};
+	alignas(64) float antipops[maxSamples * lanes]{};
+	alignas(64) float outL[maxSamples * lanes]{};
+	alignas(64) float outR[maxSamples * lanes]{};
+
+	// per lane: algorithm weights (only used by groups of mixed algos),
+	// equant and demod settings
+	alignas(64) float w3[2][lanes]{};  // epi2, epi1
+	alignas(64) float w4[3][lanes]{};  // epi3, epi2, epi1
+	alignas(64) float mixBits[3][lanes]{};  // sine4, 3, 2
+	alignas(64) float recip[lanes]{};
+	alignas(64) float demodScale[lanes]{};
+	alignas(64) float equants[lanes]{};
+	alignas(64) float mixA[lanes]{};
+	alignas(64) float mixB[lanes]{};
+
+	// per lane: output gain, SVF coefficients and state (by stage, channel)
+	alignas(64) float gains[lanes]{};
+	alignas(64) float svfA[3][lanes]{};
+	alignas(64) float svfM[2][3][lanes]{};
+	alignas(64) float svfIc1[2][2][lanes]{};
+	alignas(64) float svfIc2[2][2][lanes]{};
+};
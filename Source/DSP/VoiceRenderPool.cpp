@@ -0,0 +1,132 @@
+/*
+ * Audible Planets - an expressive, quasi-Ptolemaic semi-modular synthesizer
+ *
+ * Copyright 2024, Greg Recco
+ *
+ * Audible Planets is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * All source for Audible Planets is available at
+ * https://github.com/gregrecco67/AudiblePlanets
+ */
+
+#include "VoiceRenderPool.h"
+#include "AllocationTrap.h"
+#include "SpinWait.h"
+
+namespace {
+// how long a worker keeps polling after a batch before it sleeps: long
+// enough to span the gap between blocks at ordinary buffer sizes
+constexpr int spinsBeforeSleep = 20000;
+}  // namespace
+
+//==============================================================================
+class VoiceRenderPool::Worker final : public juce::Thread {
+public:
+	Worker(VoiceRenderPool &p, const int index_)
+	    : juce::Thread("Voice render " + juce::String(index_)), pool(p), index(index_)
+	{
+	}
+
+	void run() override
+	{
+		auto seenBatch = pool.ticket.load(std::memory_order_acquire) >> batchShift;
+		while (!threadShouldExit()) {
+			int spins = 0;
+			while ((pool.ticket.load(std::memory_order_acquire) >> batchShift) == seenBatch) {
+				if (threadShouldExit())
+					return;
+				if (++spins < spinsBeforeSleep) {
+					cpuRelax();
+					continue;
+				}
+				wake.prepareToSleep();
+				if (threadShouldExit() || (pool.ticket.load(std::memory_order_acquire) >> batchShift) != seenBatch)
+					wake.cancelSleep();
+				else
+					wake.sleep();
+				spins = 0;
+			}
+			seenBatch = pool.ticket.load(std::memory_order_acquire) >> batchShift;
+			const ScopedAllocationTrap trap;
+			while (pool.claimAndRun(index)) {}
+		}
+	}
+
+	void wakeIfSleeping() { wake.notify(); }
+
+	void stop()
+	{
+		signalThreadShouldExit();
+		wake.notify();
+		stopThread(1000);
+	}
+
+private:
+	VoiceRenderPool &pool;
+	const int index;
+	WakeFlag wake;
+};
+
+//==============================================================================
+VoiceRenderPool::~VoiceRenderPool()
+{
+	setNumThreads(1);
+}
+
+void VoiceRenderPool::setNumThreads(int numThreads)
+{
+	numThreads = juce::jlimit(1, maxThreads, numThreads);
+	if (numThreads == getNumThreads())
+		return;
+
+	for (auto &w : workers)
+		w->stop();
+	workers.clear();
+
+	for (int i = 1; i < numThreads; i++) {
+		workers.push_back(std::make_unique<Worker>(*this, i));
+		workers.back()->startThread(juce::Thread::Priority::highest);
+	}
+}
+
+void VoiceRenderPool::run(Jobs &jobs, const int numJobs)
+{
+	jassert(numJobs >= 0 && static_cast<uint64_t>(numJobs) <= fieldMask);
+
+	if (workers.empty()) {
+		for (int j = 0; j < numJobs; j++)
+			jobs.runJob(j, 0);
+		return;
+	}
+
+	current.store(&jobs, std::memory_order_relaxed);
+	jobsDone.store(0, std::memory_order_relaxed);
+	const uint64_t batch = (ticket.load(std::memory_order_relaxed) >> batchShift) + 1;
+	ticket.store(batch << batchShift | static_cast<uint64_t>(numJobs) << countShift);
+
+	for (auto &w : workers)
+		w->wakeIfSleeping();
+
+	while (claimAndRun(0)) {}
+	while (jobsDone.load(std::memory_order_acquire) < numJobs)
+		cpuRelax();
+}
+
+bool VoiceRenderPool::claimAndRun(const int worker)
+{
+	auto t = ticket.load(std::memory_order_acquire);
+	for (;;) {
+		const auto next = t & fieldMask;
+		if (next >= ((t >> countShift) & fieldMask))
+			return false;
+		if (ticket.compare_exchange_weak(t, t + 1, std::memory_order_acq_rel, std::memory_order_acquire)) {
+			// the batch can't move on until this job is counted, so current is still ours
+			current.load(std::memory_order_acquire)->runJob(static_cast<int>(next), worker);
+			jobsDone.fetch_add(1, std::memory_order_release);
+			return true;
+		}
+	}
+}
@@ -0,0 +1,64 @@
+/*
+ * Audible Planets - an expressive, quasi-Ptolemaic semi-modular synthesizer
+ *
+ * Copyright 2024, Greg Recco
+ *
+ * Audible Planets is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * All source for Audible Planets is available at
+ * https://github.com/gregrecco67/AudiblePlanets
+ */
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+//==============================================================================
+// A handful of worker threads that help the audio thread get through a list
+// of independent jobs. The audio thread publishes the jobs, takes its share,
+// and spins until the last one is done; workers spin for a while after each
+// batch and only then go to sleep, so back-to-back blocks don't pay for a
+// wake-up. No locks or allocations on either side once the threads exist.
+class VoiceRenderPool {
+public:
+	static constexpr int maxThreads = 8;
+
+	struct Jobs {
+		virtual ~Jobs() = default;
+		// worker is 0 for the audio thread, 1.. for the pool's threads
+		virtual void runJob(int job, int worker) = 0;
+	};
+
+	VoiceRenderPool() = default;
+	~VoiceRenderPool();
+
+	// threads taking part, counting the audio thread; 1 renders inline.
+	// Starts and stops threads: call with the audio thread stopped.
+	void setNumThreads(int numThreads);
+	[[nodiscard]] int getNumThreads() const { return static_cast<int>(workers.size()) + 1; }
+
+	// audio thread: runs jobs 0 .. numJobs - 1, returns once all are done
+	void run(Jobs &jobs, int numJobs);
+
+private:
+	class Worker;
+
+	// ticket = batch << 32 | numJobs << 16 | next job, so a job can only be
+	// claimed by someone who saw the batch it belongs to
+	static constexpr uint64_t batchShift = 32, countShift = 16, fieldMask = 0xffff;
+	bool claimAndRun(int worker);
+
+	std::vector<std::unique_ptr<Worker>> workers;
+	std::atomic<uint64_t> ticket{0};
+	std::atomic<Jobs *> current{nullptr};
+	std::atomic<int> jobsDone{0};
+
+	JUCE_DECLARE_NON_COPYABLE(VoiceRenderPool)
+};
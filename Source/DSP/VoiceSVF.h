@@ -0,0 +1,87 @@
+/*
+ * Audible Planets - an expressive, quasi-Ptolemaic semi-modular synthesizer
+ *
+ * Copyright 2024, Greg Recco
+ *
+ * Audible Planets is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * All source for Audible Planets is available at
+ * https://github.com/gregrecco67/AudiblePlanets
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+//==============================================================================
+// Trapezoidal (Simper) state-variable filter for a voice. tick() is written
+// once for any arithmetic type, so a voice on its own runs it on floats and a
+// VoiceBank runs the very same steps on a register of voices. 24 dB slopes
+// are two stages in series; a 12 dB slope's second stage is a pass-through.
+struct VoiceSVF {
+	struct Coeffs {
+		float a1{1.f}, a2{0.f}, a3{0.f};
+		float m0[2]{1.f, 1.f}, m1[2]{}, m2[2]{};  // per stage: in, band, low
+		int stages{1};
+	};
+
+	// type is FilterParams::type: lp 12/24, hp 12/24, bp 12/24, notch 12/24
+	[[nodiscard]] static Coeffs makeCoeffs(const int type, const float freq, const float q, const double sampleRate)
+	{
+		const auto sr = static_cast<float>(sampleRate);
+		const float g = std::tan(std::numbers::pi_v<float> * std::min(freq, sr * 0.49f) / sr);
+		const float k = 1.f / q;
+
+		Coeffs c;
+		c.a1 = 1.f / (1.f + g * (g + k));
+		c.a2 = g * c.a1;
+		c.a3 = g * c.a2;
+		c.stages = type % 2 == 0 ? 1 : 2;
+		for (int s = 0; s < c.stages; s++) {
+			switch (type / 2) {
+				case 0: c.m0[s] = 0.f; c.m1[s] = 0.f; c.m2[s] = 1.f; break;   // low
+				case 1: c.m0[s] = 1.f; c.m1[s] = -k; c.m2[s] = -1.f; break;   // high
+				case 2: c.m0[s] = 0.f; c.m1[s] = k; c.m2[s] = 0.f; break;     // band, 0 dB peak
+				default: c.m0[s] = 1.f; c.m1[s] = -k; c.m2[s] = 0.f; break;   // notch
+			}
+		}
+		return c;
+	}
+
+	template <typename T>
+	static inline T tick(const T &in, T &ic1, T &ic2, const T &a1, const T &a2, const T &a3,
+		const T &m0, const T &m1, const T &m2)
+	{
+		const T v3 = in - ic2;
+		const T v1 = a1 * ic1 + a2 * v3;
+		const T v2 = ic2 + a2 * ic1 + a3 * v3;
+		ic1 = v1 + v1 - ic1;
+		ic2 = v2 + v2 - ic2;
+		return m0 * in + m1 * v1 + m2 * v2;
+	}
+
+	// filters a stereo block in place
+	void process(const Coeffs &c, float *const *channels, const int numSamples)
+	{
+		for (int ch = 0; ch < 2; ch++) {
+			float *x = channels[ch];
+			for (int s = 0; s < c.stages; s++) {
+				for (int i = 0; i < numSamples; i++)
+					x[i] = tick(x[i], ic1[s][ch], ic2[s][ch], c.a1, c.a2, c.a3, c.m0[s], c.m1[s], c.m2[s]);
+			}
+		}
+	}
+
+	void reset()
+	{
+		std::fill_n(&ic1[0][0], 4, 0.f);
+		std::fill_n(&ic2[0][0], 4, 0.f);
+	}
+
+	float ic1[2][2]{}, ic2[2][2]{};  // by stage, channel
+};
@@ -0,0 +1,72 @@
+/*
+ * Audible Planets - an expressive, quasi-Ptolemaic semi-modular synthesizer
+ *
+ * Copyright 2024, Greg Recco
+ *
+ * Audible Planets is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * All source for Audible Planets is available at
+ * https://github.com/gregrecco67/AudiblePlanets
+ */
+
+#include "Wavetables.h"
+#include <numbers>
+
+void APWavetables::build(gin::BandLimitedLookupTables &source, const double newSampleRate)
+{
+	if (juce::approximatelyEqual(newSampleRate, sampleRate))
+		return;
+	sampleRate = newSampleRate;
+
+	sineRow.resize(rowSize);
+	for (int n = 0; n < tableSize; n++)
+		sineRow[static_cast<size_t>(n)] = static_cast<float>(
+			std::sin(2.0 * std::numbers::pi * n / tableSize));
+	sineRow[tableSize] = sineRow[0];
+
+	copyRows(triangleRows, source, gin::Wave::triangle);
+	copyRows(squareRows, source, gin::Wave::square);
+	copyRows(sawUpRows, source, gin::Wave::sawUp);
+}
+
+void APWavetables::copyRows(std::vector<float> &rows, gin::BandLimitedLookupTables &source, const gin::Wave wave)
+{
+	rows.resize(static_cast<size_t>(rowSize * numRows));
+	for (int r = 0; r < numRows; r++) {
+		// mid-band, so gin picks its table r (or its last one, for the top row)
+		const auto note = static_cast<float>(r * notesPerRow) + notesPerRow * 0.5f + 0.5f;
+		float *row = &rows[static_cast<size_t>(r * rowSize)];
+		for (int n = 0; n < tableSize; n++)
+			row[n] = source.process(wave, note, static_cast<float>(n) / tableSize);
+		row[tableSize] = row[0];
+	}
+}
+
+bool APWavetables::hasTable(const gin::Wave wave)
+{
+	return wave == gin::Wave::sine || wave == gin::Wave::triangle
+		|| wave == gin::Wave::square || wave == gin::Wave::sawUp;
+}
+
+const float *APWavetables::getRow(const gin::Wave wave, const float note) const
+{
+	if (wave == gin::Wave::sine)
+		return sineRow.data();
+
+	// the same banding as gin's lookup: row r is built for note 6r + 6.5
+	const int r = static_cast<int>(std::clamp((note - 0.5f) / notesPerRow, 0.0f, static_cast<float>(numRows - 1)));
+	switch (wave) {
+		case gin::Wave::triangle:
+			return &triangleRows[static_cast<size_t>(r * rowSize)];
+		case gin::Wave::square:
+			return &squareRows[static_cast<size_t>(r * rowSize)];
+		case gin::Wave::sawUp:
+			return &sawUpRows[static_cast<size_t>(r * rowSize)];
+		default:
+			jassertfalse;
+			return sineRow.data();
+	}
+}
@@ -0,0 +1,54 @@
+/*
+ * Audible Planets - an expressive, quasi-Ptolemaic semi-modular synthesizer
+ *
+ * Copyright 2024, Greg Recco
+ *
+ * Audible Planets is released under the GNU General Public Licence v3
+ * or later (GPL-3.0-or-later). The license is found in the "LICENSE"
+ * file in the root of this repository, or at
+ * https://www.gnu.org/licenses/gpl-3.0.en.html
+ *
+ * All source for Audible Planets is available at
+ * https://github.com/gregrecco67/AudiblePlanets
+ */
+
+#pragma once
+
+#include <gin_dsp/gin_dsp.h>
+#include <vector>
+
+//==============================================================================
+// Band-limited single-cycle tables laid out for quadrature reads: one row per
+// band of notes, each row with a guard point so linear interpolation never
+// has to wrap. The planets read x at the phase and y a quarter cycle later
+// out of the same row, so a lookup only picks the row once per block. The
+// rows are copied out of gin's own tables, band for band, so the waves are
+// exactly the ones gin's lookup has always played.
+class APWavetables {
+public:
+	static constexpr int tableOrder = 11;
+	static constexpr int tableSize = 1 << tableOrder;
+	static constexpr int tableMask = tableSize - 1;
+	static constexpr int quarter = tableSize / 4;
+	static constexpr int rowSize = tableSize + 1;  // guard point
+	static constexpr int notesPerRow = 6;          // as gin's tables
+	static constexpr int numRows = 128 / notesPerRow + 1;
+
+	// copies every row from source, which must already be at the rate the
+	// planets run at; allocates, so call from prepareToPlay
+	void build(gin::BandLimitedLookupTables &source, double sampleRate);
+
+	// true for the waves we keep tables for (everything but the noises)
+	[[nodiscard]] static bool hasTable(gin::Wave wave);
+
+	// the row gin's lookup would read for this key, banded as a MIDI note;
+	// the oscillator passes its frequency, as it always has
+	[[nodiscard]] const float *getRow(gin::Wave wave, float note) const;
+
+private:
+	void copyRows(std::vector<float> &rows, gin::BandLimitedLookupTables &source, gin::Wave wave);
+
+	double sampleRate{0.0};
+	std::vector<float> sineRow;
+	std::vector<float> triangleRows, squareRows, sawUpRows;
+};
@@ -83,7 +83,7 @@ void APAudioProcessorEditor::timerCallback()
 	if (!isVisible())
 		return;
 	if (MTS_HasMaster(proc.client)) {
-		scaleName.setText(proc.scaleName, juce::dontSendNotification);
+		scaleName.setText(MTS_GetScaleName(proc.client), juce::dontSendNotification);
 		scaleName.setColour(juce::Label::backgroundColourId,
 		    juce::Colour(0xff16171A).brighter(0.3f));
 	} else {
@@ -91,12 +91,13 @@ void APAudioProcessorEditor::timerCallback()
 		scaleName.setColour(
 		    juce::Label::backgroundColourId, juce::Colours::transparentBlack);
 	}
-	if (proc.learning.isEmpty()) {
+	if (const auto learn = proc.modMatrix.getLearn(); learn.id == -1) {
 		learningLabel.setText("", juce::dontSendNotification);
 		learningLabel.setColour(
 		    juce::Label::backgroundColourId, juce::Colours::transparentBlack);
 	} else {
-		learningLabel.setText(proc.learning, juce::dontSendNotification);
+		learningLabel.setText("Learning: " + proc.modMatrix.getModSrcName(learn),
+		    juce::dontSendNotification);
 		learningLabel.setColour(juce::Label::backgroundColourId,
 		    juce::Colour(0xff16171A).brighter(0.3f));
 	}